@@ -0,0 +1,297 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary listing format for HFSNew-like records (address, sqmeters, price).
+//
+// Layout (version 2, native little-endian):
+//
+//  +--------------------+ 0
+//  | ListingHeader      |   64 bytes, self-checksummed
+//  +--------------------+ recordsOffset
+//  | ListingRecord[n]   |   fixed width, 32 bytes each
+//  +--------------------+ heapOffset
+//  | string heap        |   addresses back to back, no terminators
+//  +--------------------+ heapOffset + heapSize
+//
+// The file is opened with mmap and queried in place: there is no parse step
+// and no std::string per address, a record's address is a string_view into the heap.
+
+namespace listing
+{
+
+constexpr char Magic[8] = {'H', 'F', 'S', 'L', 'I', 'S', 'T', '\0'};
+constexpr std::uint32_t Version = 2; // 2: 64-bit heap offsets, 32-byte records
+
+struct ListingHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint64_t count;
+    std::uint64_t recordsOffset;
+    std::uint64_t heapOffset;
+    std::uint64_t heapSize;
+    std::uint32_t recordsCrc;
+    std::uint32_t heapCrc;
+    std::uint32_t headerCrc; // crc of every byte above this field
+    std::uint32_t reserved;
+};
+static_assert(sizeof(ListingHeader) == 64, "ListingHeader must stay 64 bytes");
+
+struct ListingRecord
+{
+    double sqmeters;
+    double price;
+    std::uint64_t addressOffset; // relative to the start of the heap, which may exceed 4 GiB
+    std::uint32_t addressLength;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(ListingRecord) == 32, "ListingRecord must stay 32 bytes");
+
+// Plain table driven CRC-32 (IEEE 802.3 polynomial, reflected).
+inline std::uint32_t crc32(const void* data, std::size_t n, std::uint32_t crc = 0)
+{
+    static const auto table = []
+    {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Non-owning view of one record. It mirrors HFSNew's interface but
+// never copies the address out of the mapping.
+class HFSView
+{
+public:
+    HFSView(std::string_view address_, double sqmeters_, double price_) : address{address_}, sqmeters{sqmeters_}, price{price_} {}
+    std::string_view getAddress() const { return address; }
+    double getSqmeters() const { return sqmeters; }
+    double getPrice() const { return price; }
+    void print() const
+    {
+        std::cout << "Address: " << address << "\n";
+        std::cout << "Squared meters: " << sqmeters << "\n";
+        std::cout << "Price: " << price << "\n";
+    }
+private:
+    std::string_view address;
+    double sqmeters;
+    double price;
+};
+
+// Collects records and writes a complete listing file in one go.
+class ListingWriter
+{
+public:
+    void add(std::string_view address, double sqmeters, double price)
+    {
+        if (address.size() > UINT32_MAX)
+        {
+            throw std::length_error("listing address exceeds 4 GiB");
+        }
+        records.push_back({sqmeters, price, heap.size(), static_cast<std::uint32_t>(address.size()), 0});
+        heap.append(address);
+    }
+
+    void write(const std::string& path) const
+    {
+        ListingHeader h{};
+        std::memcpy(h.magic, Magic, sizeof(Magic));
+        h.version = Version;
+        h.headerSize = sizeof(ListingHeader);
+        h.count = records.size();
+        h.recordsOffset = sizeof(ListingHeader);
+        h.heapOffset = h.recordsOffset + records.size() * sizeof(ListingRecord);
+        h.heapSize = heap.size();
+        h.recordsCrc = crc32(records.data(), records.size() * sizeof(ListingRecord));
+        h.heapCrc = crc32(heap.data(), heap.size());
+        h.headerCrc = crc32(&h, offsetof(ListingHeader, headerCrc));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path + " for writing");
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ListingRecord));
+        out.write(heap.data(), heap.size());
+        if (!out)
+        {
+            throw std::runtime_error("failed writing " + path);
+        }
+    }
+
+private:
+    std::vector<ListingRecord> records;
+    std::string heap;
+};
+
+// Read-only mapping of a listing file. Opening maps the file and checks the header
+// and the section bounds, a constant amount of work whatever the file size; each
+// record is checked against the heap when it is read, and record and address
+// pages are faulted in lazily by the records actually touched.
+// Like HFSNew it cannot be copied (it owns the mapping), but it can be moved.
+class MappedListing
+{
+public:
+    explicit MappedListing(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ListingHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error(path + " is too small to be a listing");
+        }
+        length = static_cast<std::size_t>(st.st_size);
+        void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (p == MAP_FAILED)
+        {
+            throw std::runtime_error("mmap failed for " + path);
+        }
+        base = static_cast<const char*>(p);
+        try
+        {
+            validateHeader();
+        }
+        catch (...)
+        {
+            ::munmap(const_cast<char*>(base), length);
+            throw;
+        }
+    }
+
+    MappedListing(const MappedListing&) = delete;
+    MappedListing& operator=(const MappedListing&) = delete;
+    MappedListing(MappedListing&& other) noexcept : base{other.base}, length{other.length}
+    {
+        other.base = nullptr;
+        other.length = 0;
+    }
+    MappedListing& operator=(MappedListing&& other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            base = other.base;
+            length = other.length;
+            other.base = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+    ~MappedListing() { unmap(); }
+
+    std::size_t size() const { return header().count; }
+
+    // Like vector's, operator[] trusts i < size(); at() checks it. Both check that the record's
+    // address lies inside the heap, so a corrupt record throws instead of reading outside the mapping.
+    HFSView operator[](std::size_t i) const
+    {
+        const ListingRecord& r = records()[i];
+        const std::uint64_t heapSize = header().heapSize;
+        if (r.addressOffset > heapSize || r.addressLength > heapSize - r.addressOffset)
+        {
+            throw std::runtime_error("listing record " + std::to_string(i) + " points outside the string heap");
+        }
+        return HFSView(std::string_view(heap() + r.addressOffset, r.addressLength), r.sqmeters, r.price);
+    }
+
+    HFSView at(std::size_t i) const
+    {
+        if (i >= size())
+        {
+            throw std::out_of_range("listing record " + std::to_string(i) + " out of range");
+        }
+        return (*this)[i];
+    }
+
+    // Full checksum of the record and heap sections. It touches every page,
+    // so it is not done on open; call it from a background job or after a copy.
+    bool verify() const
+    {
+        const ListingHeader& h = header();
+        return crc32(records(), h.count * sizeof(ListingRecord)) == h.recordsCrc
+            && crc32(heap(), h.heapSize) == h.heapCrc;
+    }
+
+private:
+    const char* base = nullptr;
+    std::size_t length = 0;
+
+    const ListingHeader& header() const { return *reinterpret_cast<const ListingHeader*>(base); }
+    const ListingRecord* records() const { return reinterpret_cast<const ListingRecord*>(base + header().recordsOffset); }
+    const char* heap() const { return base + header().heapOffset; }
+
+    void validateHeader() const
+    {
+        const ListingHeader& h = header();
+        if (std::memcmp(h.magic, Magic, sizeof(Magic)) != 0)
+        {
+            throw std::runtime_error("not a listing file (bad magic)");
+        }
+        if (h.version != Version || h.headerSize != sizeof(ListingHeader))
+        {
+            throw std::runtime_error("unsupported listing version " + std::to_string(h.version));
+        }
+        if (crc32(&h, offsetof(ListingHeader, headerCrc)) != h.headerCrc)
+        {
+            throw std::runtime_error("listing header checksum mismatch");
+        }
+        // Written as a > size - b rather than a + b > size, so that no field can overflow its way
+        // past a check.
+        if (h.recordsOffset < sizeof(ListingHeader) || h.recordsOffset > length
+            || h.recordsOffset % alignof(ListingRecord) != 0
+            || h.count > (length - h.recordsOffset) / sizeof(ListingRecord)
+            || h.heapOffset != h.recordsOffset + h.count * sizeof(ListingRecord)
+            || h.heapSize != length - h.heapOffset)
+        {
+            throw std::runtime_error("listing sections do not match the file size");
+        }
+    }
+
+    void unmap()
+    {
+        if (base)
+        {
+            ::munmap(const_cast<char*>(base), length);
+            base = nullptr;
+        }
+    }
+};
+
+} // namespace listing
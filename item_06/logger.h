@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+#include "uncopyable.h"
+
+// Asynchronous logger. Each producing thread gets its own single-producer/single-consumer
+// ring of fixed-size records, so log() is a memcpy and one release store: no lock,
+// no allocation, no system call. A background thread drains all rings, batches the
+// formatted text and hands it to the file descriptor with one write() per batch.
+class Logger : public Uncopyable
+{
+public:
+    static constexpr std::size_t MaxMessage = 240; // longer messages are truncated
+
+    // What a producer does when its ring buffer is full.
+    enum class Overflow
+    {
+        Drop,  // discard the record and count it, the hot path never waits
+        Block  // spin/yield until the background thread has made room
+    };
+
+    Logger(const std::string& name_, int fd_ = STDOUT_FILENO, Overflow policy_ = Overflow::Drop, std::size_t capacity_ = 4096)
+        : name{name_}, fd{fd_}, policy{policy_}, capacity{roundUpPow2(capacity_)}, id{nextId()}, start{Clock::now()},
+          flusher{[this] { flushLoop(); }}
+    {
+    }
+
+    ~Logger()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_one();
+        flusher.join(); // the flusher drains every ring before it returns
+        for (const auto& r : rings)
+        {
+            r->loggerGone.store(true, std::memory_order_release); // threads still caching it let go
+        }
+    }
+
+    // Returns false if the record was dropped because the ring was full.
+    bool log(std::string_view msg)
+    {
+        Ring& r = localRing();
+        const std::uint64_t tail = r.tail.load(std::memory_order_relaxed);
+        if (tail - r.headCache >= capacity)
+        {
+            r.headCache = r.head.load(std::memory_order_acquire);
+            while (tail - r.headCache >= capacity)
+            {
+                if (policy == Overflow::Drop)
+                {
+                    r.dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                cv.notify_one();
+                std::this_thread::yield();
+                r.headCache = r.head.load(std::memory_order_acquire);
+            }
+        }
+        Record& rec = r.slots[tail & (capacity - 1)];
+        rec.nanos = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        rec.length = static_cast<std::uint32_t>(std::min(msg.size(), MaxMessage));
+        std::memcpy(rec.text, msg.data(), rec.length);
+        r.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of records discarded under Overflow::Drop so far.
+    std::uint64_t dropped() const
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        std::uint64_t total = retiredDropped;
+        for (const auto& r : rings)
+        {
+            total += r->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Rings currently allocated: one per thread that has logged and not yet exited, plus exited
+    // threads' rings that the flusher has not emptied yet.
+    std::size_t ringCount() const
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        return rings.size();
+    }
+
+    const std::string& getName() const { return name; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Record
+    {
+        std::uint64_t nanos;
+        std::uint32_t length;
+        char text[MaxMessage];
+    };
+
+    struct Ring
+    {
+        explicit Ring(std::size_t capacity_) : slots(new Record[capacity_]) {}
+        std::unique_ptr<Record[]> slots;
+        alignas(64) std::atomic<std::uint64_t> head{0}; // advanced by the flusher
+        alignas(64) std::atomic<std::uint64_t> tail{0}; // advanced by the owning thread
+        std::uint64_t headCache = 0;                     // producer-private copy of head
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> threadGone{false};             // the owning thread has exited
+        std::atomic<bool> loggerGone{false};             // the Logger has been destroyed
+    };
+
+    // A thread's rings, one per Logger it has logged to. Rings are shared between the Logger and
+    // the thread: when the thread exits it marks its rings, and the flusher frees each one once it
+    // has drained it; when a Logger is destroyed first, the thread drops the ring on its next
+    // registration, or at exit.
+    struct LocalRings
+    {
+        std::vector<std::pair<std::uint64_t, std::shared_ptr<Ring>>> entries; // by logger id
+        ~LocalRings()
+        {
+            for (const auto& entry : entries)
+            {
+                entry.second->threadGone.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    std::string name;
+    int fd;
+    Overflow policy;
+    std::size_t capacity;
+    std::uint64_t id;
+    Clock::time_point start;
+
+    mutable std::mutex ringsMutex; // taken when a thread registers, by the flusher and by dropped()
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::uint64_t retiredDropped = 0; // dropped counts of the rings already freed
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread flusher; // declared last so everything above exists before it starts
+
+    static std::size_t roundUpPow2(std::size_t n)
+    {
+        std::size_t p = 2;
+        while (p < n)
+        {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    static std::uint64_t nextId()
+    {
+        static std::atomic<std::uint64_t> counter{0};
+        return ++counter;
+    }
+
+    // Rings are looked up through a thread_local cache keyed by logger id (not by address,
+    // which a later Logger could reuse), so registration is paid once per thread and logger.
+    Ring& localRing()
+    {
+        thread_local LocalRings cache;
+        for (const auto& [loggerId, ring] : cache.entries)
+        {
+            if (loggerId == id)
+            {
+                return *ring;
+            }
+        }
+        std::erase_if(cache.entries, [](const auto& entry) { return entry.second->loggerGone.load(std::memory_order_acquire); });
+        auto ring = std::make_shared<Ring>(capacity);
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(ring);
+        }
+        cache.entries.emplace_back(id, ring);
+        return *ring;
+    }
+
+    // Moves everything currently published into batch, returns the number of records. Rings of
+    // exited threads are freed once drained.
+    std::size_t drain(std::string& batch)
+    {
+        std::vector<Ring*> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (const auto& r : rings)
+            {
+                snapshot.push_back(r.get());
+            }
+        }
+        std::size_t n = 0;
+        bool retired = false;
+        for (Ring* r : snapshot)
+        {
+            retired |= r->threadGone.load(std::memory_order_acquire);
+            std::uint64_t head = r->head.load(std::memory_order_relaxed);
+            const std::uint64_t tail = r->tail.load(std::memory_order_acquire);
+            for (; head != tail; ++head, ++n)
+            {
+                const Record& rec = r->slots[head & (capacity - 1)];
+                batch += '[';
+                batch += name;
+                batch += ' ';
+                batch += std::to_string(rec.nanos);
+                batch += "] ";
+                batch.append(rec.text, rec.length);
+                batch += '\n';
+            }
+            r->head.store(head, std::memory_order_release);
+        }
+        if (retired)
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            std::erase_if(rings, [this](const std::shared_ptr<Ring>& r)
+            {
+                // threadGone is read before tail, so the tail seen is the thread's last one.
+                if (!r->threadGone.load(std::memory_order_acquire)
+                    || r->head.load(std::memory_order_relaxed) != r->tail.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+                retiredDropped += r->dropped.load(std::memory_order_relaxed);
+                return true;
+            });
+        }
+        return n;
+    }
+
+    void writeAll(const std::string& batch) const
+    {
+        std::size_t done = 0;
+        while (done < batch.size())
+        {
+            ssize_t w = ::write(fd, batch.data() + done, batch.size() - done);
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                return; // a logger has nowhere to report its own failures
+            }
+            done += static_cast<std::size_t>(w);
+        }
+    }
+
+    void flushLoop()
+    {
+        std::string batch;
+        batch.reserve(1 << 16);
+        for (;;)
+        {
+            bool stop;
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stop = stopping;
+            }
+            std::size_t n = drain(batch);
+            if (!batch.empty())
+            {
+                writeAll(batch);
+                batch.clear();
+            }
+            if (stop)
+            {
+                if (drain(batch) > 0) // records published while we were writing
+                {
+                    writeAll(batch);
+                }
+                return;
+            }
+            if (n == 0)
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping; });
+            }
+        }
+    }
+};
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <string>
+#include "uncopyable.h"
+#include "logger.h"
 
 class HFSOld
 {
@@ -45,22 +47,7 @@ private:
 // This will generate compile time error that are clear and preferred. 
 // Do not use the privately declared unimplemented trick.
 
-class Uncopyable
-{
-public:
-    Uncopyable() = default;
-    ~Uncopyable() = default;
-    Uncopyable(const Uncopyable&) = delete;
-    Uncopyable& operator=(const Uncopyable&) = delete;
-};
-
-class Logger : public Uncopyable
-{
-public:
-    Logger(const std::string& name_) : name{name_} {}
-private:
-    std::string name;
-};
+// Uncopyable lives in uncopyable.h and Logger in logger.h (an asynchronous logger, see main3.cpp).
 
 // One can use inheritance to automate the process of doing a class uncopyable, by publicly inheriting from the 
 // class Uncopyable which has deleted its copy constructor and copy assignment operators.
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "listing.h"
+
+// Text round trip, the way listings used to be loaded: one std::string per address.
+struct TextHouse
+{
+    std::string address;
+    double sqmeters;
+    double price;
+};
+
+std::vector<TextHouse> loadText(const std::string& text)
+{
+    std::vector<TextHouse> houses;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        auto a = line.find('|');
+        auto b = line.find('|', a + 1);
+        houses.push_back({line.substr(0, a), std::stod(line.substr(a + 1, b - a - 1)), std::stod(line.substr(b + 1))});
+    }
+    return houses;
+}
+
+int main()
+{
+    using Clock = std::chrono::steady_clock;
+    const std::size_t n = 500000;
+    const std::string path = "houses.lst";
+
+    listing::ListingWriter writer;
+    std::string text;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        std::string address = std::to_string(i % 400 + 1) + ", " + std::to_string(i) + " Manchester Road";
+        double sqmeters = 30.0 + static_cast<double>(i % 90);
+        double price = 1000.0 * sqmeters * 9.0;
+        writer.add(address, sqmeters, price);
+        text += address + "|" + std::to_string(sqmeters) + "|" + std::to_string(price) + "\n";
+    }
+    writer.write(path);
+
+    auto t0 = Clock::now();
+    auto houses = loadText(text);
+    auto t1 = Clock::now();
+    listing::MappedListing mapped(path);
+    auto t2 = Clock::now();
+
+    std::cout << "Text load of " << houses.size() << " houses: "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+    std::cout << "Mapped open of " << mapped.size() << " houses: "
+              << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+
+    mapped[0].print();
+    mapped[n - 1].print();
+    std::cout << "Checksums " << (mapped.verify() ? "ok" : "MISMATCH") << "\n";
+
+    // A record only becomes an owning HFSNew-style object when somebody asks for one.
+    std::string owned(mapped[42].getAddress());
+    std::cout << "Owned copy: " << owned << "\n";
+
+    std::remove(path.c_str());
+}
+
+/*
+Build: g++ -std=c++20 -O2 main2.cpp -o main2
+
+Every restart used to rebuild the houses from text, which means parsing every number and
+allocating a std::string per address (the cost grows with the file). The binary listing
+moves that work to the writer:
+
+    * numbers live in a fixed-width section, so record i is at recordsOffset + 32*i,
+    * addresses live in a string heap and records hold (offset, length) pairs into it; offsets
+      are 64-bit (version 2), since the addresses of a 20 GB listing take far more than 4 GiB,
+    * the header carries a magic, a version and checksums.
+
+Opening is an mmap and a 64-byte header check, whose section bounds must add up to the file size;
+it reads nothing else, so it takes the same time for any file size. Each record's (offset, length)
+pair is checked against the string heap when operator[] reads it, so a corrupt record throws
+instead of reading outside the mapping. The kernel pages records and addresses in on first touch
+and shares them across processes. The section checksums are only verified on request (verify()),
+since checking them means reading the whole file.
+
+MappedListing follows Item 6: copying would double-unmap the region, so copy operations are
+deleted, while moving just transfers ownership of the mapping.
+*/
@@ -0,0 +1,10 @@
+#pragma once
+
+class Uncopyable
+{
+public:
+    Uncopyable() = default;
+    ~Uncopyable() = default;
+    Uncopyable(const Uncopyable&) = delete;
+    Uncopyable& operator=(const Uncopyable&) = delete;
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <experimental/simd>
+#include <initializer_list>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include "fastmath.h"
+
+// Closed-form Black-Scholes prices for the payoffs of payoff.h:
+// PayoffCall(K) pays max(S_T-K,0) and PayoffPut(K) pays max(K-S_T,0) at Expiry, and the
+// prices below are their discounted expectations under GBM with constant Rate and Vol.
+
+namespace blackscholes
+{
+
+inline double normalCdf(double x)
+{
+    return 0.5 * std::erfc(-x / std::numbers::sqrt2);
+}
+
+inline double callPrice(double Spot, double Strike, double Rate, double Vol, double Expiry)
+{
+    const double df = std::exp(-Rate * Expiry);
+    const double sd = Vol * std::sqrt(Expiry);
+    if (sd <= 0.0)
+    {
+        return std::max(Spot - Strike * df, 0.0); // no uncertainty left: discounted intrinsic value
+    }
+    const double d1 = (std::log(Spot / Strike) + Rate * Expiry) / sd + 0.5 * sd;
+    return Spot * normalCdf(d1) - Strike * df * normalCdf(d1 - sd);
+}
+
+inline double putPrice(double Spot, double Strike, double Rate, double Vol, double Expiry)
+{
+    // put-call parity
+    return callPrice(Spot, Strike, Rate, Vol, Expiry) - Spot + Strike * std::exp(-Rate * Expiry);
+}
+
+// Batch kernels over structure-of-arrays inputs: option i has Spot[i], Strike[i], Vol[i], Rate[i]
+// and Expiry[i], each field in its own contiguous array, so a SIMD register holds the same field
+// of consecutive options. They use the fastmath approximations (prices agree with callPrice and
+// putPrice to about 1e-15 of the spot) and need Vol > 0 and Expiry > 0.
+struct OptionBatch
+{
+    std::span<const double> Spot;
+    std::span<const double> Strike;
+    std::span<const double> Vol;
+    std::span<const double> Rate;
+    std::span<const double> Expiry;
+
+    std::size_t size() const { return Spot.size(); }
+};
+
+// Outputs of the Greeks kernels; theta is per year of calendar time (-d price / d Expiry).
+struct GreeksBatch
+{
+    std::span<double> price;
+    std::span<double> delta;
+    std::span<double> gamma;
+    std::span<double> vega;
+    std::span<double> theta;
+    std::span<double> rho;
+};
+
+namespace batch
+{
+namespace stdx = std::experimental;
+using Vec = fastmath::Vec;
+
+// inputs[0] is the batch size; every other input must have it and every output at least it.
+inline void checkSizes(std::initializer_list<std::size_t> inputs, std::initializer_list<std::size_t> outputs)
+{
+    const std::size_t n = *inputs.begin();
+    for (std::size_t size : inputs)
+    {
+        if (size != n)
+        {
+            throw std::invalid_argument("blackscholes: batch inputs of different lengths");
+        }
+    }
+    for (std::size_t size : outputs)
+    {
+        if (size < n)
+        {
+            throw std::invalid_argument("blackscholes: batch output shorter than the inputs");
+        }
+    }
+}
+
+inline void checkSizes(const OptionBatch& in, std::initializer_list<std::size_t> outputs)
+{
+    checkSizes({in.Spot.size(), in.Strike.size(), in.Vol.size(), in.Rate.size(), in.Expiry.size()}, outputs);
+}
+
+// Runs kernel(i, count, one Vec per field) on full vectors of the fields, and on the tail through
+// padded buffers (padding lanes get harmless inputs and their outputs are dropped).
+template <typename Kernel, typename... Fields>
+void forEachVector(std::size_t n, Kernel kernel, Fields... fields)
+{
+    const std::size_t simdEnd = n - n % Vec::size();
+    for (std::size_t i = 0; i < simdEnd; i += Vec::size())
+    {
+        kernel(i, Vec::size(), Vec(&fields[i], stdx::element_aligned)...);
+    }
+    if (simdEnd < n)
+    {
+        auto tail = [&](std::span<const double> field)
+        {
+            double buffer[Vec::size()];
+            std::fill(buffer, buffer + Vec::size(), 1.0);
+            std::copy(field.begin() + simdEnd, field.begin() + n, buffer);
+            return Vec(buffer, stdx::element_aligned);
+        };
+        kernel(simdEnd, n - simdEnd, tail(fields)...);
+    }
+}
+
+template <typename Kernel>
+void forEach(const OptionBatch& in, Kernel kernel)
+{
+    forEachVector(in.size(), kernel, in.Spot, in.Strike, in.Vol, in.Rate, in.Expiry);
+}
+
+inline void store(const Vec& v, std::span<double> out, std::size_t i, std::size_t count)
+{
+    if (count == Vec::size())
+    {
+        v.copy_to(&out[i], stdx::element_aligned);
+        return;
+    }
+    double buffer[Vec::size()];
+    v.copy_to(buffer, stdx::element_aligned);
+    std::copy(buffer, buffer + count, out.begin() + i);
+}
+
+template <bool Call>
+void prices(const OptionBatch& in, std::span<double> out)
+{
+    checkSizes(in, {out.size()});
+    forEach(in, [&](std::size_t i, std::size_t count, Vec S, Vec K, Vec vol, Vec r, Vec T)
+    {
+        const Vec sd = vol * fastmath::sqrt(T);
+        const Vec df = fastmath::exp(-r * T);
+        const Vec d1 = (fastmath::log(S / K) + r * T) / sd + 0.5 * sd;
+        const Vec call = S * fastmath::normalCdf(d1) - K * df * fastmath::normalCdf(d1 - sd);
+        store(Call ? call : call - S + K * df, out, i, count); // puts by parity
+    });
+}
+
+template <bool Call>
+void greeks(const OptionBatch& in, const GreeksBatch& out)
+{
+    checkSizes(in, {out.price.size(), out.delta.size(), out.gamma.size(), out.vega.size(), out.theta.size(), out.rho.size()});
+    forEach(in, [&](std::size_t i, std::size_t count, Vec S, Vec K, Vec vol, Vec r, Vec T)
+    {
+        const Vec rootT = fastmath::sqrt(T);
+        const Vec sd = vol * rootT;
+        const Vec df = fastmath::exp(-r * T);
+        const Vec d1 = (fastmath::log(S / K) + r * T) / sd + 0.5 * sd;
+        const Vec density = fastmath::exp(-0.5 * d1 * d1) * (0.5 * std::numbers::inv_sqrtpi * std::numbers::sqrt2);
+        const Vec n1 = fastmath::normalCdf(d1);
+        const Vec n2 = fastmath::normalCdf(d1 - sd);
+        const Vec discountedStrike = K * df;
+        const Vec call = S * n1 - discountedStrike * n2;
+        const Vec decay = -S * density * vol / (2.0 * rootT); // the time value part of theta
+        if constexpr (Call)
+        {
+            store(call, out.price, i, count);
+            store(n1, out.delta, i, count);
+            store(decay - r * discountedStrike * n2, out.theta, i, count);
+            store(discountedStrike * T * n2, out.rho, i, count);
+        }
+        else
+        {
+            store(call - S + discountedStrike, out.price, i, count);
+            store(n1 - 1.0, out.delta, i, count);
+            store(decay + r * discountedStrike * (1.0 - n2), out.theta, i, count);
+            store(-discountedStrike * T * (1.0 - n2), out.rho, i, count);
+        }
+        store(density / (S * sd), out.gamma, i, count);
+        store(S * density * rootT, out.vega, i, count);
+    });
+}
+} // namespace batch
+
+inline void callPrices(const OptionBatch& in, std::span<double> out) { batch::prices<true>(in, out); }
+inline void putPrices(const OptionBatch& in, std::span<double> out) { batch::prices<false>(in, out); }
+inline void callGreeks(const OptionBatch& in, const GreeksBatch& out) { batch::greeks<true>(in, out); }
+inline void putGreeks(const OptionBatch& in, const GreeksBatch& out) { batch::greeks<false>(in, out); }
+
+} // namespace blackscholes
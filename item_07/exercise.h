@@ -0,0 +1,10 @@
+#pragma once
+
+// When the holder of an option may exercise it, for the engines that can price early exercise
+// (lattice.h, fdsolver.h). Exercise pays the Payoff of the spot at that time.
+enum class Exercise
+{
+    European,
+    American, // at every time step before expiry
+    Bermudan  // at given dates only, rounded to the nearest time step
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <experimental/simd>
+
+// Vectorized exp, log and standard normal CDF for the batch Black-Scholes kernels.
+//
+// libstdc++ evaluates std::experimental::exp and log one lane at a time through libm, which
+// defeats the point of a SIMD batch. These versions are plain polynomial evaluations on whole
+// vectors, with bit manipulation for the power-of-two part.
+// Errors measured against libm (item_07/main7.cpp):
+//
+//     exp(x)        relative error 2.2e-16 (1 ulp)   for x in [-708, 709]; clamped outside
+//     log(x)        1 ulp of the result              for positive normal x
+//     normalCdf(x)  absolute error 2.2e-16           for all x; relative error up to 1e-8 for x < -7
+//
+// normalCdf is Hart's 1968 rational, as given by West (2005); its far-tail continued fraction is
+// truncated after five terms, which is why the relative error grows there.
+
+namespace fastmath
+{
+
+namespace stdx = std::experimental;
+using Vec = stdx::native_simd<double>;
+using Bits = stdx::rebind_simd_t<std::int64_t, Vec>;
+
+// Reinterprets the lanes of a simd as another type of the same width. The TS has no bit cast, so
+// this goes through std::bit_cast on arrays; the compiler turns the copies into a register move.
+template <typename To, typename From>
+inline To bitCast(const From& x)
+{
+    static_assert(To::size() == From::size() && sizeof(typename To::value_type) == sizeof(typename From::value_type));
+    std::array<typename From::value_type, From::size()> in;
+    x.copy_to(in.data(), stdx::element_aligned);
+    const auto out = std::bit_cast<std::array<typename To::value_type, To::size()>>(in);
+    return To(out.data(), stdx::element_aligned);
+}
+
+inline Vec exp(Vec x)
+{
+    constexpr double log2e = 1.4426950408889634;
+    constexpr double ln2Hi = 6.93147180369123816490e-01; // ln 2 = ln2Hi + ln2Lo, ln2Hi exact in 32 bits
+    constexpr double ln2Lo = 1.90821492927058770002e-10;
+    constexpr double shifter = 0x1.8p52; // adding and subtracting it rounds to the nearest integer
+    x = stdx::clamp(x, Vec(-708.0), Vec(709.0));
+    const Vec k = (x * log2e + shifter) - shifter;
+    const Vec r = (x - k * ln2Hi) - k * ln2Lo; // |r| <= ln 2 / 2
+    // Taylor series to degree 13: the first term left out, r^14 / 14!, is below 5e-18.
+    Vec p = 1.0 / 6227020800.0;
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    const Bits exponent = (stdx::static_simd_cast<Bits>(k) + 1023) << 52;
+    return p * bitCast<Vec>(exponent);
+}
+
+// stdx::sqrt is a single vsqrtpd, but with AVX-512 GCC 12 reports a spurious
+// -Wmaybe-uninitialized inside its intrinsics wherever it is inlined.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+inline Vec sqrt(Vec x)
+{
+    return stdx::sqrt(x);
+}
+#pragma GCC diagnostic pop
+
+inline Vec log(Vec x)
+{
+    constexpr double ln2Hi = 6.93147180369123816490e-01;
+    constexpr double ln2Lo = 1.90821492927058770002e-10;
+    constexpr double sqrt2 = 1.4142135623730951;
+    const Bits bits = bitCast<Bits>(x);
+    Vec e = stdx::static_simd_cast<Vec>((bits >> 52) - 1023);
+    Vec m = bitCast<Vec>((bits & 0x000FFFFFFFFFFFFFll) | 0x3FF0000000000000ll); // [1, 2)
+    const auto high = m > sqrt2;
+    where(high, m) = 0.5 * m; // m in [sqrt(1/2), sqrt(2))
+    where(high, e) = e + 1.0;
+    // log m = 2 atanh(f) = 2 (f + f^3/3 + f^5/5 + ...), f = (m-1)/(m+1), |f| <= 0.1716.
+    // Terms to f^19: the first one left out, 2 f^21 / 21, is below 1e-17.
+    const Vec f = (m - 1.0) / (m + 1.0);
+    const Vec s = f * f;
+    Vec p = 2.0 / 19.0;
+    p = p * s + 2.0 / 17.0;
+    p = p * s + 2.0 / 15.0;
+    p = p * s + 2.0 / 13.0;
+    p = p * s + 2.0 / 11.0;
+    p = p * s + 2.0 / 9.0;
+    p = p * s + 2.0 / 7.0;
+    p = p * s + 2.0 / 5.0;
+    p = p * s + 2.0 / 3.0;
+    const Vec logM = f * (2.0 + s * p);
+    return e * ln2Hi + (logM + e * ln2Lo);
+}
+
+// Hart's double-precision algorithm 5666 for N(x): a rational function times exp(-x^2/2) for
+// |x| < 7.07, a continued fraction beyond, N(x) = 1 - N(-x) for x > 0.
+inline Vec normalCdf(Vec x)
+{
+    const Vec a = stdx::abs(x);
+    const Vec e = exp(-0.5 * a * a);
+    Vec num = 3.52624965998911e-02;
+    num = num * a + 0.700383064443688;
+    num = num * a + 6.37396220353165;
+    num = num * a + 33.912866078383;
+    num = num * a + 112.079291497871;
+    num = num * a + 221.213596169931;
+    num = num * a + 220.206867912376;
+    Vec den = 8.83883476483184e-02;
+    den = den * a + 1.75566716318264;
+    den = den * a + 16.064177579207;
+    den = den * a + 86.7807322029461;
+    den = den * a + 296.564248779674;
+    den = den * a + 637.333633378831;
+    den = den * a + 793.826512519948;
+    den = den * a + 440.413735824752;
+    Vec tail = e * num / den;
+    const auto far = a >= 7.07106781186547;
+    if (stdx::any_of(far))
+    {
+        Vec cf = a + 0.65;
+        cf = a + 4.0 / cf;
+        cf = a + 3.0 / cf;
+        cf = a + 2.0 / cf;
+        cf = a + 1.0 / cf;
+        where(far, tail) = e / cf / 2.506628274631;
+    }
+    where(a > 37.0, tail) = Vec(0.0);
+    where(x > 0.0, tail) = 1.0 - tail;
+    return tail;
+}
+
+} // namespace fastmath
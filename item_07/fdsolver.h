@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <experimental/simd>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "exercise.h"
+#include "payoff.h"
+
+// Crank-Nicolson finite differences for the Black-Scholes PDE in x = log(S/Spot), for European and
+// American Payoffs. With tau the time to expiry:
+//
+//     u_tau = 1/2 vol^2 u_xx + (r - 1/2 vol^2) u_x - r u,       u(x, 0) = payoff(Spot e^x)
+//
+// Coefficients are constant in x, so each time step is one tridiagonal solve whose matrix never
+// changes: it is factorized once (Thomas forward elimination), and each step only substitutes.
+//
+// Instruments are solved Vec::size() at a time, one per SIMD lane. Each instrument has its own
+// market, grid spacing and time step, but every instrument in a group has the same numbers of
+// nodes and steps, so the Thomas recurrences run lane-parallel on a node-major layout
+// (node i of lane k at i * lanes + k). All buffers are allocated once per price() call and reused
+// by every group and every time step.
+//
+// The first two steps are replaced by four implicit Euler half steps (Rannacher start-up), which
+// damps the oscillations Crank-Nicolson keeps from a kinked payoff. American exercise is applied
+// by projection after each step: u = max(u, payoff).
+
+struct FDInstrument
+{
+    const Payoff* payoff;
+    double Spot;
+    double Rate;
+    double Vol;
+    double Expiry;
+    Exercise exercise = Exercise::European;
+};
+
+class FDSolver
+{
+public:
+    // The grid covers +-width standard deviations of log(S_T) around its mean for every instrument.
+    explicit FDSolver(std::size_t spaceSteps_ = 400, std::size_t timeSteps_ = 200, double width_ = 5.0)
+        : spaceSteps{spaceSteps_ + spaceSteps_ % 2}, timeSteps{timeSteps_}, width{width_}
+    {
+        if (spaceSteps < 4 || timeSteps < 2 || width <= 0.0)
+        {
+            throw std::invalid_argument("FDSolver: at least 4 space steps, 2 time steps and a positive width");
+        }
+    }
+
+    double price(const FDInstrument& instrument) const
+    {
+        return price(std::span<const FDInstrument>(&instrument, 1))[0];
+    }
+
+    std::vector<double> price(std::span<const FDInstrument> instruments) const
+    {
+        for (const FDInstrument& in : instruments)
+        {
+            if (!in.payoff || in.Spot <= 0.0 || in.Vol <= 0.0 || in.Expiry <= 0.0)
+            {
+                throw std::invalid_argument("FDSolver: every instrument needs a payoff and positive spot, vol and expiry");
+            }
+            if (in.exercise == Exercise::Bermudan)
+            {
+                throw std::invalid_argument("FDSolver: Bermudan exercise is not supported, use Lattice");
+            }
+        }
+        Buffers buffers(spaceSteps + 1);
+        std::vector<double> prices(instruments.size());
+        for (std::size_t first = 0; first < instruments.size(); first += Lanes)
+        {
+            solveGroup(instruments, first, buffers, prices);
+        }
+        return prices;
+    }
+
+private:
+    using Vec = std::experimental::native_simd<double>;
+    static constexpr std::size_t Lanes = Vec::size();
+    static constexpr auto aligned = std::experimental::element_aligned;
+
+    std::size_t spaceSteps; // even, so that the middle node is x = 0, the spot itself
+    std::size_t timeSteps;
+    double width;
+
+    struct Buffers
+    {
+        explicit Buffers(std::size_t nodes)
+            : u(nodes * Lanes), rhs(nodes * Lanes), upperPrime(nodes * Lanes), inverse(nodes * Lanes),
+              intrinsic(nodes * Lanes), spots(nodes), values(nodes)
+        {
+        }
+        std::vector<double> u;          // node-major, Lanes values per node
+        std::vector<double> rhs;        // right-hand side, then the forward-substituted values
+        std::vector<double> upperPrime; // Thomas factorization: c'_i and 1 / (b_i - a c'_{i-1})
+        std::vector<double> inverse;
+        std::vector<double> intrinsic;  // payoff at every node: initial condition and exercise floor
+        std::vector<double> spots;      // one lane's spots, for Payoff::evaluate
+        std::vector<double> values;
+    };
+
+    // Per-lane constants of one group.
+    struct Group
+    {
+        const FDInstrument* lane[Lanes];
+        double xMin[Lanes];
+        double dx[Lanes];
+        double dt[Lanes];
+        double american[Lanes]; // 1 for American lanes
+        bool anyAmerican;
+    };
+
+    template <typename F>
+    static Vec perLane(F f)
+    {
+        return Vec([&](auto k) { return f(static_cast<std::size_t>(k)); });
+    }
+
+    void solveGroup(std::span<const FDInstrument> instruments, std::size_t first, Buffers& buf, std::vector<double>& prices) const
+    {
+        const std::size_t nodes = spaceSteps + 1;
+        const std::size_t used = std::min(Lanes, instruments.size() - first);
+        Group g;
+        g.anyAmerican = false;
+        for (std::size_t k = 0; k < Lanes; ++k)
+        {
+            const FDInstrument& in = instruments[first + (k < used ? k : 0)]; // idle lanes repeat the first
+            const double drift = (in.Rate - 0.5 * in.Vol * in.Vol) * in.Expiry;
+            const double halfWidth = width * in.Vol * std::sqrt(in.Expiry) + std::abs(drift);
+            g.lane[k] = &in;
+            g.xMin[k] = -halfWidth;
+            g.dx[k] = 2.0 * halfWidth / static_cast<double>(spaceSteps);
+            g.dt[k] = in.Expiry / static_cast<double>(timeSteps);
+            g.american[k] = in.exercise == Exercise::American ? 1.0 : 0.0;
+            g.anyAmerican = g.anyAmerican || in.exercise == Exercise::American;
+            for (std::size_t i = 0; i < nodes; ++i)
+            {
+                buf.spots[i] = in.Spot * std::exp(g.xMin[k] + static_cast<double>(i) * g.dx[k]);
+            }
+            in.payoff->evaluate(buf.spots, buf.values);
+            for (std::size_t i = 0; i < nodes; ++i)
+            {
+                buf.intrinsic[i * Lanes + k] = buf.values[i];
+            }
+        }
+        std::copy(buf.intrinsic.begin(), buf.intrinsic.end(), buf.u.begin());
+
+        // L u_i = a u_{i-1} + b u_i + c u_{i+1}; half a time step of it on each side of the scheme.
+        const Vec vol = perLane([&](std::size_t k) { return g.lane[k]->Vol; });
+        const Vec rate = perLane([&](std::size_t k) { return g.lane[k]->Rate; });
+        const Vec dx = perLane([&](std::size_t k) { return g.dx[k]; });
+        const Vec diffusion = 0.5 * vol * vol / (dx * dx);
+        const Vec convection = (rate - 0.5 * vol * vol) / (2.0 * dx);
+        const Vec halfDt = perLane([&](std::size_t k) { return 0.5 * g.dt[k]; });
+        const Vec a = halfDt * (diffusion - convection);
+        const Vec b = halfDt * (-2.0 * diffusion - rate);
+        const Vec c = halfDt * (diffusion + convection);
+        factorize(-a, 1.0 - b, -c, buf);
+
+        double tau[Lanes] = {};
+        for (int half = 0; half < 4; ++half) // Rannacher: implicit Euler with dt/2 uses the same matrix
+        {
+            advance(g, tau, 0.5);
+            step(g, tau, a, b, c, false, buf);
+        }
+        for (std::size_t n = 2; n < timeSteps; ++n)
+        {
+            advance(g, tau, 1.0);
+            step(g, tau, a, b, c, true, buf);
+        }
+        for (std::size_t k = 0; k < used; ++k)
+        {
+            prices[first + k] = buf.u[(spaceSteps / 2) * Lanes + k];
+        }
+    }
+
+    static void advance(const Group& g, double* tau, double fraction)
+    {
+        for (std::size_t k = 0; k < Lanes; ++k)
+        {
+            tau[k] += fraction * g.dt[k];
+        }
+    }
+
+    // Forward elimination of the interior system, which is the same at every step:
+    // lower u_{i-1} + diag u_i + upper u_{i+1} = rhs_i, i = 1..M-1.
+    void factorize(Vec lower, Vec diag, Vec upper, Buffers& buf) const
+    {
+        Vec prime(0.0);
+        for (std::size_t i = 1; i < spaceSteps; ++i)
+        {
+            const Vec inv = 1.0 / (diag - lower * prime);
+            prime = upper * inv;
+            inv.copy_to(&buf.inverse[i * Lanes], aligned);
+            prime.copy_to(&buf.upperPrime[i * Lanes], aligned);
+        }
+    }
+
+    // One time step to tau. crankNicolson: rhs = (I + dt/2 L) u; otherwise an implicit half step, rhs = u.
+    void step(const Group& g, const double* tau, Vec a, Vec b, Vec c, bool crankNicolson, Buffers& buf) const
+    {
+        const std::size_t M = spaceSteps;
+        const Vec lower = -a, upper = -c; // the off-diagonals of the factorized matrix
+        double* u = buf.u.data();
+        double* d = buf.rhs.data();
+        Vec below(&u[0], aligned), here(&u[Lanes], aligned);
+        for (std::size_t i = 1; i < M; ++i)
+        {
+            const Vec above(&u[(i + 1) * Lanes], aligned);
+            const Vec r = crankNicolson ? a * below + (1.0 + b) * here + c * above : here;
+            r.copy_to(&d[i * Lanes], aligned);
+            below = here;
+            here = above;
+        }
+
+        // Boundaries: far from the strike the option is worth its payoff at the forward, discounted.
+        double lowerBoundary[Lanes], upperBoundary[Lanes];
+        for (std::size_t k = 0; k < Lanes; ++k)
+        {
+            const FDInstrument& in = *g.lane[k];
+            const double growth = std::exp(in.Rate * tau[k]);
+            const double lowSpot = in.Spot * std::exp(g.xMin[k]);
+            const double highSpot = in.Spot * std::exp(g.xMin[k] + static_cast<double>(M) * g.dx[k]);
+            lowerBoundary[k] = (*in.payoff)(lowSpot * growth) / growth;
+            upperBoundary[k] = (*in.payoff)(highSpot * growth) / growth;
+            if (in.exercise == Exercise::American)
+            {
+                lowerBoundary[k] = std::max(lowerBoundary[k], (*in.payoff)(lowSpot));
+                upperBoundary[k] = std::max(upperBoundary[k], (*in.payoff)(highSpot));
+            }
+        }
+        const Vec low(lowerBoundary, aligned), high(upperBoundary, aligned);
+        low.copy_to(&u[0], aligned);
+        high.copy_to(&u[M * Lanes], aligned);
+
+        // Substitution with the stored factorization; the known boundary values move to the right.
+        Vec prev(0.0);
+        for (std::size_t i = 1; i < M; ++i)
+        {
+            Vec r(&d[i * Lanes], aligned);
+            if (i == 1)
+            {
+                r -= lower * low;
+            }
+            if (i == M - 1)
+            {
+                r -= upper * high;
+            }
+            prev = (r - lower * prev) * Vec(&buf.inverse[i * Lanes], aligned);
+            prev.copy_to(&d[i * Lanes], aligned);
+        }
+        Vec next = high;
+        for (std::size_t i = M - 1; i >= 1; --i)
+        {
+            Vec x = Vec(&d[i * Lanes], aligned);
+            if (i < M - 1)
+            {
+                x -= Vec(&buf.upperPrime[i * Lanes], aligned) * next;
+            }
+            x.copy_to(&u[i * Lanes], aligned);
+            next = x;
+        }
+
+        // American lanes: project onto the exercise constraint.
+        if (g.anyAmerican)
+        {
+            const auto american = Vec(g.american, aligned) != 0.0;
+            for (std::size_t i = 1; i < M; ++i)
+            {
+                Vec x(&u[i * Lanes], aligned);
+                where(american, x) = std::experimental::max(x, Vec(&buf.intrinsic[i * Lanes], aligned));
+                x.copy_to(&u[i * Lanes], aligned);
+            }
+        }
+    }
+};
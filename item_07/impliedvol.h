@@ -0,0 +1,115 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <experimental/simd>
+#include <limits>
+#include <numbers>
+#include <span>
+#include "blackscholes.h"
+#include "fastmath.h"
+
+// Batch implied volatilities: the Vol at which blackscholes::callPrice (or putPrice) returns the
+// quoted Price, for PayoffCall / PayoffPut quotes stored as structure of arrays.
+//
+// Every quote is first normalized. With F = Spot e^(Rate Expiry), x = log(F / Strike) and
+// s = Vol sqrt(Expiry), the undiscounted call price divided by sqrt(F Strike) is
+//
+//     b(x, s) = e^(x/2) N(x/s + s/2) - e^(-x/2) N(x/s - s/2)
+//
+// and the normalized put is b(-x, s). Parity turns every quote into the out-of-the-money one, so
+// each lane solves b(-|x|, s) = target: no intrinsic value to cancel, and one function to invert.
+//
+// The solve is the same for every lane: Corrado-Miller's closed-form guess, or where it is larger a
+// guess from the leading tail term of b, then a fixed number of Halley steps on log b(s) - log
+// target, which is concave in s and well scaled for the tiny prices of far out-of-the-money quotes.
+// Lanes differ only through where() masks. Quotes outside the no-arbitrage bounds give NaN: a call
+// must be worth more than max(Spot - discounted Strike, 0) and less than Spot, a put more than
+// max(discounted Strike - Spot, 0) and less than the discounted Strike.
+
+namespace blackscholes
+{
+
+struct QuoteBatch
+{
+    std::span<const double> Spot;
+    std::span<const double> Strike;
+    std::span<const double> Rate;
+    std::span<const double> Expiry;
+    std::span<const double> Price;
+
+    std::size_t size() const { return Spot.size(); }
+};
+
+namespace batch
+{
+
+// Halley steps after the initial guess; main8.cpp shows the error after each one.
+inline constexpr int impliedVolSteps = 3;
+
+// Solves b(x, s) = target for s, x <= 0, lane by lane; target is in (0, e^(x/2)).
+inline Vec normalizedVol(Vec x, Vec target, int steps = impliedVolSteps)
+{
+    const Vec up = fastmath::exp(0.5 * x), down = 1.0 / up;
+
+    // Corrado-Miller, in normalized units (spot e^(x/2), forward strike e^(-x/2)).
+    const Vec half = 0.5 * (up - down);
+    const Vec a = target - half;
+    const Vec root = fastmath::sqrt(stdx::max(a * a - 4.0 * half * half * std::numbers::inv_pi, Vec(0.0)));
+    Vec s = std::sqrt(2.0 * std::numbers::pi) / (up + down) * (a + root);
+    // Far out of the money Corrado-Miller collapses towards 0, where b has no slope to follow; the
+    // leading term of b there, exp(-x^2 / (2 s^2)), gives a guess from below instead.
+    const Vec logTarget = fastmath::log(target);
+    const Vec tailGuess = stdx::abs(x) / fastmath::sqrt(stdx::max(-2.0 * logTarget, Vec(1e-300)));
+    s = stdx::max(stdx::max(s, tailGuess), Vec(1e-8));
+
+    constexpr double density = 0.5 * std::numbers::inv_sqrtpi * std::numbers::sqrt2;
+    for (int step = 0; step < steps; ++step)
+    {
+        const Vec d1 = x / s + 0.5 * s, d2 = d1 - s;
+        const Vec b = up * fastmath::normalCdf(d1) - down * fastmath::normalCdf(d2);
+        const Vec vega = up * density * fastmath::exp(-0.5 * d1 * d1);
+        // f = log b - log target: f' = vega / b, f'' = f' (d1 d2 / s - f').
+        const Vec f = fastmath::log(b) - logTarget;
+        const Vec slope = vega / b;
+        const Vec curvature = slope * (d1 * d2 / s - slope);
+        const Vec newton = f / slope;
+        Vec next = s - newton / (1.0 - 0.5 * newton * curvature / slope);
+        // Halley's correction can overshoot where the curvature changes fast; fall back to Newton
+        // and keep s positive.
+        where(!(next > 0.0) || stdx::abs(next - s) > stdx::abs(2.0 * newton), next) = s - newton;
+        where(!(next > 0.0), next) = 0.5 * s;
+        where(b > 0.0, s) = next; // b underflows only at the root of a target below 1e-300
+    }
+    return s;
+}
+
+template <bool Call>
+void impliedVols(const QuoteBatch& in, std::span<double> out)
+{
+    checkSizes({in.Spot.size(), in.Strike.size(), in.Rate.size(), in.Expiry.size(), in.Price.size()}, {out.size()});
+    forEachVector(in.size(), [&](std::size_t i, std::size_t count, Vec S, Vec K, Vec r, Vec T, Vec price)
+    {
+        const Vec df = fastmath::exp(-r * T);
+        const Vec x = fastmath::log(S / K) + r * T;
+        const Vec scale = df * fastmath::sqrt(S * K / df); // df sqrt(F K)
+        const Vec up = fastmath::exp(0.5 * x);
+        const Vec intrinsic = up - 1.0 / up; // normalized forward intrinsic value of the call
+        const Vec b = price / scale;
+        // The out-of-the-money price: a call with x > 0 less its intrinsic value is the put, and
+        // the other way round.
+        const Vec otm = Call ? b - stdx::max(intrinsic, Vec(0.0)) : b - stdx::max(-intrinsic, Vec(0.0));
+        const Vec xOtm = -stdx::abs(x);
+        const auto valid = otm > 0.0 && otm < fastmath::exp(0.5 * xOtm);
+        Vec target = otm;
+        where(!valid, target) = 0.5 * fastmath::exp(0.5 * xOtm); // any solvable value; the lane is dropped
+        Vec vol = normalizedVol(xOtm, target) / fastmath::sqrt(T);
+        where(!valid, vol) = Vec(std::numeric_limits<double>::quiet_NaN());
+        store(vol, out, i, count);
+    }, in.Spot, in.Strike, in.Rate, in.Expiry, in.Price);
+}
+} // namespace batch
+
+inline void callImpliedVols(const QuoteBatch& in, std::span<double> out) { batch::impliedVols<true>(in, out); }
+inline void putImpliedVols(const QuoteBatch& in, std::span<double> out) { batch::impliedVols<false>(in, out); }
+
+} // namespace blackscholes
@@ -0,0 +1,241 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <experimental/simd>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "exercise.h"
+#include "payoff.h"
+
+// Recombining binomial (Cox-Ross-Rubinstein) and trinomial (Hull, stretch sqrt(3)) trees for any
+// Payoff, with European, American or Bermudan exercise.
+//
+// A tree is never built as nodes. Level n is one contiguous run of values, rolled back in place:
+//
+//     binomial:  v[j] = a v[j+1] + b v[j],                  j = 0..n       (n+1 nodes)
+//     trinomial: v[j] = a v[j+2] + m v[j+1] + b v[j],       j = 0..2n      (2n+1 nodes)
+//
+// Each new value only reads values at or above its own index, so a forward SIMD sweep over the
+// same array is safe. The spots of a level are a contiguous run too, read from a table computed once
+// per price() call and handed to Payoff::evaluate once per level for the exercise values: one
+// virtual call per level, not per node.
+
+enum class LatticeType
+{
+    Binomial,
+    Trinomial
+};
+
+class Lattice
+{
+public:
+    Lattice(LatticeType type_, double Spot_, double Rate_, double Vol_, double Expiry_, std::size_t steps_)
+        : type{type_}, Spot{Spot_}, steps{steps_}
+    {
+        if (Spot <= 0.0 || Vol_ <= 0.0 || Expiry_ <= 0.0 || steps == 0)
+        {
+            throw std::invalid_argument("Lattice: spot, vol, expiry and steps must be positive");
+        }
+        dt = Expiry_ / static_cast<double>(steps);
+        const double disc = std::exp(-Rate_ * dt);
+        if (type == LatticeType::Binomial)
+        {
+            up = std::exp(Vol_ * std::sqrt(dt));
+            const double p = (std::exp(Rate_ * dt) - 1.0 / up) / (up - 1.0 / up);
+            if (p <= 0.0 || p >= 1.0)
+            {
+                throw std::invalid_argument("Lattice: too few steps for this rate and vol (probability outside (0,1))");
+            }
+            upWeight = disc * p;
+            downWeight = disc * (1.0 - p);
+        }
+        else
+        {
+            up = std::exp(Vol_ * std::sqrt(3.0 * dt));
+            const double tilt = (Rate_ - 0.5 * Vol_ * Vol_) * std::sqrt(dt / (12.0 * Vol_ * Vol_));
+            if (std::abs(tilt) >= 1.0 / 6.0)
+            {
+                throw std::invalid_argument("Lattice: too few steps for this rate and vol (negative probability)");
+            }
+            upWeight = disc * (1.0 / 6.0 + tilt);
+            midWeight = disc * 2.0 / 3.0;
+            downWeight = disc * (1.0 / 6.0 - tilt);
+        }
+    }
+
+    void setExercise(Exercise exercise_, const std::vector<double>& dates = {})
+    {
+        if (exercise_ == Exercise::Bermudan && dates.empty())
+        {
+            throw std::invalid_argument("Lattice: Bermudan exercise needs at least one date");
+        }
+        if (exercise_ != Exercise::Bermudan && !dates.empty())
+        {
+            throw std::invalid_argument("Lattice: exercise dates are only meaningful for Bermudan exercise");
+        }
+        exerciseStep.assign(steps, exercise_ == Exercise::American);
+        for (double t : dates)
+        {
+            const double step = std::round(t / dt);
+            if (step < 0.0 || step > static_cast<double>(steps))
+            {
+                throw std::invalid_argument("Lattice: exercise date outside [0, Expiry]");
+            }
+            if (step < static_cast<double>(steps)) // at expiry the payoff is paid anyway
+            {
+                exerciseStep[static_cast<std::size_t>(step)] = true;
+            }
+        }
+    }
+
+    double price(const Payoff& payoff) const
+    {
+        const Payoff* one[] = {&payoff};
+        return price(one)[0];
+    }
+
+    // Batch mode: every payoff rolled back through the same pass over the levels. The tree, its
+    // spots and the exercise schedule are shared; each payoff keeps its own row of values.
+    std::vector<double> price(std::span<const Payoff* const> payoffs) const
+    {
+        const std::size_t width = nodes(steps);
+        const std::vector<double> spots = spotTable();
+        std::vector<double> exerciseValues(width);
+        std::vector<double> values(payoffs.size() * width);
+
+        for (std::size_t k = 0; k < payoffs.size(); ++k)
+        {
+            payoffs[k]->evaluate(levelSpots(spots, steps), std::span<double>(values.data() + k * width, width));
+        }
+        for (std::size_t n = steps; n-- > 0;)
+        {
+            const std::size_t count = nodes(n);
+            for (std::size_t k = 0; k < payoffs.size(); ++k)
+            {
+                const double* floor = nullptr;
+                if (exerciseStep[n])
+                {
+                    payoffs[k]->evaluate(levelSpots(spots, n), std::span<double>(exerciseValues.data(), count));
+                    floor = exerciseValues.data();
+                }
+                rollBack(values.data() + k * width, count, floor);
+            }
+        }
+        std::vector<double> prices(payoffs.size());
+        for (std::size_t k = 0; k < payoffs.size(); ++k)
+        {
+            prices[k] = values[k * width];
+        }
+        return prices;
+    }
+
+private:
+    using Vec = std::experimental::native_simd<double>;
+    static constexpr auto aligned = std::experimental::element_aligned;
+
+    LatticeType type;
+    double Spot;
+    std::size_t steps;
+    double dt = 0.0;
+    double up = 1.0;
+    double upWeight = 0.0; // transition probabilities times the one-step discount factor
+    double midWeight = 0.0;
+    double downWeight = 0.0;
+    std::vector<bool> exerciseStep = std::vector<bool>(steps, false);
+
+    std::size_t nodes(std::size_t n) const { return type == LatticeType::Binomial ? n + 1 : 2 * n + 1; }
+
+    // Spot * u^k for every exponent k a level reaches, laid out so that each level's spots are one
+    // contiguous run. Trinomial level n has k = -n..n, a run starting at k = -steps + (steps - n);
+    // binomial level n has k = -n, -n+2, ..., n, so the table holds two rows of steps+1 entries, one
+    // per parity of k. Each entry is one exp of the final exponent: a product of separate factors
+    // such as u^-n and u^2j overflows (or underflows) long before the spot it stands for, at
+    // vol * sqrt(T * steps) of about 354. Past about 709 the top spots themselves overflow; they are
+    // capped, with headroom for rounding in rollBack, at nodes whose probability is far below 1e-300.
+    std::vector<double> spotTable() const
+    {
+        const double cap = std::numeric_limits<double>::max() / 4.0;
+        const double lnUp = std::log(up);
+        const double s = static_cast<double>(steps);
+        if (type == LatticeType::Trinomial)
+        {
+            std::vector<double> table(2 * steps + 1);
+            for (std::size_t i = 0; i < table.size(); ++i)
+            {
+                table[i] = std::min(Spot * std::exp(lnUp * (static_cast<double>(i) - s)), cap);
+            }
+            return table;
+        }
+        std::vector<double> table(2 * (steps + 1));
+        for (std::size_t parity = 0; parity < 2; ++parity)
+        {
+            for (std::size_t i = 0; i <= steps; ++i)
+            {
+                const double k = 2.0 * static_cast<double>(i) - s - static_cast<double>(parity);
+                table[parity * (steps + 1) + i] = std::min(Spot * std::exp(lnUp * k), cap);
+            }
+        }
+        return table;
+    }
+
+    std::span<const double> levelSpots(const std::vector<double>& table, std::size_t n) const
+    {
+        if (type == LatticeType::Trinomial)
+        {
+            return std::span<const double>(table.data() + (steps - n), nodes(n));
+        }
+        const std::size_t parity = (steps - n) % 2;
+        return std::span<const double>(table.data() + parity * (steps + 1) + (steps - n + parity) / 2, nodes(n));
+    }
+
+    // From level n+1 to level n (count nodes), in place. With exercise values the continuation
+    // value is floored by them in the same sweep.
+    void rollBack(double* v, std::size_t count, const double* floor) const
+    {
+        if (type == LatticeType::Binomial)
+        {
+            floor ? rollBack<false, true>(v, count, floor) : rollBack<false, false>(v, count, floor);
+        }
+        else
+        {
+            floor ? rollBack<true, true>(v, count, floor) : rollBack<true, false>(v, count, floor);
+        }
+    }
+
+    template <bool Trinomial, bool Floored>
+    void rollBack(double* v, std::size_t count, const double* floor) const
+    {
+        constexpr std::size_t top = Trinomial ? 2 : 1; // offset of the up move
+        const std::size_t simdEnd = count - count % Vec::size();
+        const Vec a(upWeight), m(midWeight), b(downWeight);
+        for (std::size_t j = 0; j < simdEnd; j += Vec::size())
+        {
+            Vec x = a * Vec(v + j + top, aligned) + b * Vec(v + j, aligned);
+            if constexpr (Trinomial)
+            {
+                x += m * Vec(v + j + 1, aligned);
+            }
+            if constexpr (Floored)
+            {
+                x = std::experimental::max(x, Vec(floor + j, aligned));
+            }
+            x.copy_to(v + j, aligned);
+        }
+        for (std::size_t j = simdEnd; j < count; ++j)
+        {
+            double x = upWeight * v[j + top] + downWeight * v[j];
+            if constexpr (Trinomial)
+            {
+                x += midWeight * v[j + 1];
+            }
+            if constexpr (Floored)
+            {
+                x = std::max(x, floor[j]);
+            }
+            v[j] = x;
+        }
+    }
+};
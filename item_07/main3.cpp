@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+#include "payoffholder.h"
+
+// Counts every global allocation so we can see where the heap is touched.
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// A payoff too large for the inline buffer: it still works, through the heap.
+class PayoffTable : public Payoff
+{
+public:
+    PayoffTable(double Strike_) : Strike{Strike_} {}
+    double operator()(double Spot) const override { return Spot > Strike ? weights[0] : 0.0; }
+    Payoff* clone() const override { return new PayoffTable(*this); }
+private:
+    double Strike;
+    double weights[16] = {1.0};
+};
+
+int main()
+{
+    const std::size_t n = 100000;
+    std::cout << "sizeof(PayoffHolder) = " << sizeof(PayoffHolder) << "\n";
+
+    std::vector<std::unique_ptr<Payoff>> cloned;
+    cloned.reserve(n);
+    std::size_t before = allocations;
+    PayoffCall call(100.0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        cloned.emplace_back(call.clone()); // Item 7 style polymorphic copy: one new per payoff
+    }
+    std::cout << "clone():      " << allocations - before << " allocations for " << n << " payoffs\n";
+
+    std::vector<PayoffHolder> held;
+    held.reserve(n);
+    before = allocations;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (i % 2)
+        {
+            held.emplace_back(PayoffCall(100.0 + i % 10));
+        }
+        else
+        {
+            held.emplace_back(PayoffPut(100.0 - i % 10));
+        }
+    }
+    std::vector<PayoffHolder> copy = held; // one allocation, for the vector's storage
+    std::cout << "PayoffHolder: " << allocations - before << " allocations for " << 2 * n << " payoffs\n";
+
+    PayoffHolder big = PayoffTable(100.0);
+    PayoffHolder moved = std::move(big);
+    std::cout << "PayoffTable stored inline? " << moved.isInline() << ", value at 120: " << moved(120.0) << "\n";
+    std::cout << "copy[1](120) = " << copy[1](120.0) << ", copy[0](90) = " << copy[0](90.0) << "\n";
+}
+
+/*
+Build: g++ -std=c++20 -O2 main3.cpp -o main3
+
+clone() returns a new object, so a container of payoffs is a container of pointers: one heap
+allocation per element, a matching delete later, and elements scattered across the heap.
+
+PayoffHolder keeps the Item 7 interface (everything still goes through the virtual Payoff
+functions) but owns the object by value. When the concrete type is known at construction and
+fits in 48 bytes, it is placement-new'ed into the holder's buffer and a per-type table of
+copy/move functions is remembered, so copying and moving holders never allocates and a
+std::vector<PayoffHolder> is one contiguous block. Types that are too large (or not nothrow
+movable) go to the heap and are copied with clone(), so nothing stops working.
+
+The destructor of an inline payoff is called explicitly through Payoff*, which is only
+correct because ~Payoff is virtual.
+*/
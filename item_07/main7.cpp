@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "blackscholes.h"
+
+namespace stdx = std::experimental;
+using fastmath::Vec;
+
+// Largest error of a vectorized function against a reference over the given arguments.
+template <typename Fast, typename Reference>
+double worstError(const std::vector<double>& xs, Fast fast, Reference reference, bool relative)
+{
+    double worst = 0.0;
+    for (std::size_t i = 0; i + Vec::size() <= xs.size(); i += Vec::size())
+    {
+        double out[Vec::size()];
+        fast(Vec(&xs[i], stdx::element_aligned)).copy_to(out, stdx::element_aligned);
+        for (std::size_t k = 0; k < Vec::size(); ++k)
+        {
+            const double exact = reference(xs[i + k]);
+            const double error = std::abs(out[k] - exact) / (relative ? exact : 1.0);
+            worst = std::max(worst, error);
+        }
+    }
+    return worst;
+}
+
+int main()
+{
+    // 1. Accuracy of the approximations against libm.
+    std::mt19937_64 rng(7);
+    auto sample = [&](double lo, double hi)
+    {
+        std::uniform_real_distribution<double> u(lo, hi);
+        std::vector<double> xs(1 << 22);
+        std::generate(xs.begin(), xs.end(), [&] { return u(rng); });
+        return xs;
+    };
+    std::vector<double> logArgs(1 << 22);
+    std::uniform_real_distribution<double> exponent(-1000.0, 1000.0);
+    std::generate(logArgs.begin(), logArgs.end(), [&] { return std::exp2(exponent(rng)); });
+    std::printf("exp        relative error %.2e on [-708, 709], %.2e on [-1, 1]\n",
+                worstError(sample(-708.0, 709.0), [](Vec x) { return fastmath::exp(x); }, [](double x) { return std::exp(x); }, true),
+                worstError(sample(-1.0, 1.0), [](Vec x) { return fastmath::exp(x); }, [](double x) { return std::exp(x); }, true));
+    std::printf("log        absolute error %.2e on [2^-1000, 2^1000], %.2e on [0.5, 2]\n",
+                worstError(logArgs, [](Vec x) { return fastmath::log(x); }, [](double x) { return std::log(x); }, false),
+                worstError(sample(0.5, 2.0), [](Vec x) { return fastmath::log(x); }, [](double x) { return std::log(x); }, false));
+    std::printf("normalCdf  absolute error %.2e on [-40, 40], relative %.2e on [-37, -7]\n\n",
+                worstError(sample(-40.0, 40.0), [](Vec x) { return fastmath::normalCdf(x); }, blackscholes::normalCdf, false),
+                worstError(sample(-37.0, -7.0), [](Vec x) { return fastmath::normalCdf(x); }, blackscholes::normalCdf, true));
+
+    // 2. A book of random options, priced by the batch kernels and by the scalar formulas.
+    const std::size_t n = 1 << 20;
+    std::vector<double> spot(n), strike(n), vol(n), rate(n), expiry(n);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        spot[i] = 100.0;
+        strike[i] = 50.0 + 100.0 * u(rng);
+        vol[i] = 0.05 + 0.75 * u(rng);
+        rate[i] = 0.1 * u(rng);
+        expiry[i] = 0.02 + 5.0 * u(rng);
+    }
+    const blackscholes::OptionBatch book{spot, strike, vol, rate, expiry};
+    std::vector<double> calls(n), puts(n), reference(n);
+    std::vector<double> price(n), delta(n), gamma(n), vega(n), theta(n), rho(n);
+    const blackscholes::GreeksBatch greeks{price, delta, gamma, vega, theta, rho};
+
+    blackscholes::callPrices(book, calls);
+    blackscholes::putPrices(book, puts);
+    double callError = 0.0, putError = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        callError = std::max(callError, std::abs(calls[i] - blackscholes::callPrice(spot[i], strike[i], rate[i], vol[i], expiry[i])));
+        putError = std::max(putError, std::abs(puts[i] - blackscholes::putPrice(spot[i], strike[i], rate[i], vol[i], expiry[i])));
+    }
+    // Greeks of one option against central differences of the scalar price.
+    blackscholes::callGreeks(book, greeks);
+    const std::size_t j = 12345;
+    auto call = [&](double s, double r, double v, double t) { return blackscholes::callPrice(s, strike[j], r, v, t); };
+    const double h = 1e-4;
+    std::printf("batch against scalar, %zu options: calls %.2e, puts %.2e\n", n, callError, putError);
+    std::printf("option %zu greeks: delta %.6f (%.6f)  gamma %.6f (%.6f)  vega %.4f (%.4f)  theta %.4f (%.4f)  rho %.4f (%.4f)\n\n", j,
+                delta[j], (call(spot[j] + h, rate[j], vol[j], expiry[j]) - call(spot[j] - h, rate[j], vol[j], expiry[j])) / (2 * h),
+                gamma[j], (call(spot[j] + 0.01, rate[j], vol[j], expiry[j]) - 2 * calls[j] + call(spot[j] - 0.01, rate[j], vol[j], expiry[j])) / 1e-4,
+                vega[j], (call(spot[j], rate[j], vol[j] + h, expiry[j]) - call(spot[j], rate[j], vol[j] - h, expiry[j])) / (2 * h),
+                theta[j], -(call(spot[j], rate[j], vol[j], expiry[j] + h) - call(spot[j], rate[j], vol[j], expiry[j] - h)) / (2 * h),
+                rho[j], (call(spot[j], rate[j] + h, vol[j], expiry[j]) - call(spot[j], rate[j] - h, vol[j], expiry[j])) / (2 * h));
+
+    // 3. Throughput, best of several passes over the book.
+    auto rate_ = [&](auto&& pass)
+    {
+        double best = 1e300;
+        for (int repeat = 0; repeat < 10; ++repeat)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            pass();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        }
+        return static_cast<double>(n) / best / 1e6;
+    };
+    const double scalar = rate_([&]
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            reference[i] = blackscholes::callPrice(spot[i], strike[i], rate[i], vol[i], expiry[i]);
+        }
+    });
+    const double batchPrices = rate_([&] { blackscholes::callPrices(book, calls); });
+    const double batchGreeks = rate_([&] { blackscholes::callGreeks(book, greeks); });
+    std::printf("million options per second, one core, %zu lanes:\n", Vec::size());
+    std::printf("  scalar callPrice   %8.1f\n  batch callPrices   %8.1f\n  batch callGreeks   %8.1f\n", scalar, batchPrices, batchGreeks);
+}
+
+/*
+Build: g++ -std=c++20 -O2 -march=native main7.cpp -o main7
+(needs libstdc++, the one standard library that ships std::experimental::simd complete; fastmath.h
+itself only uses the TS interface and std::bit_cast)
+
+The scalar formulas spend nearly all their time in libm: a log, an exp and two erfc per option, each
+a call that the compiler cannot vectorize, and std::experimental::exp or log on a simd vector is
+still one libm call per lane in libstdc++. fastmath.h replaces them with branch-free polynomial
+evaluations on whole vectors: exp by range reduction to |r| <= ln2/2 and a Taylor polynomial with the
+power of two built in the exponent bits, log by splitting off the exponent and an atanh series of the
+mantissa, and N(x) by Hart's rational approximation. The first section checks their errors against
+libm; they stay at a few ulp, far below anything a price needs.
+
+The batch kernels take the book as structure of arrays (one contiguous array per field), so each
+load fills a register with one field of consecutive options, and the tail goes through padded
+buffers instead of a scalar loop. Puts come from parity, and the Greeks reuse d1, N(d1), N(d2) and
+the density. On a shared AVX-512 test machine prices ran at about 80 million options per second per
+core and prices with all five Greeks at about 60 million, some 60 times the scalar loop; the 100
+million target of the risk runs needs a faster core than that one. The rate depends on the clock
+and on memory bandwidth (the Greeks kernel writes six arrays), so it is printed, not assumed.
+*/
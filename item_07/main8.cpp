@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "impliedvol.h"
+
+int main()
+{
+    // A surface of quotes: strikes 50..200 (spot 100), expiries a week to five years, vols 5%..150%,
+    // half calls and half puts, priced with the scalar formulas.
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const std::size_t n = 1 << 20;
+    std::vector<double> spot(n, 100.0), strike(n), rate(n), expiry(n), vol(n), calls(n), puts(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        strike[i] = 100.0 * std::exp2(-1.0 + 2.0 * u(rng));
+        rate[i] = 0.08 * u(rng);
+        expiry[i] = std::exp(std::log(1.0 / 52.0) + std::log(5.0 * 52.0) * u(rng));
+        vol[i] = 0.05 + 1.45 * u(rng);
+        calls[i] = blackscholes::callPrice(spot[i], strike[i], rate[i], vol[i], expiry[i]);
+        puts[i] = blackscholes::putPrice(spot[i], strike[i], rate[i], vol[i], expiry[i]);
+    }
+
+    // 1. Convergence: normalized solves with 0..4 Halley steps. Quotes worth less than 1e-10 of the
+    // spot are left out; their vol is not determined to more than a few digits by a double price.
+    std::vector<double> xs, targets, exact;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double x = -std::abs(std::log(spot[i] / strike[i]) + rate[i] * expiry[i]);
+        const double s = vol[i] * std::sqrt(expiry[i]);
+        const double b = std::exp(0.5 * x) * blackscholes::normalCdf(x / s + 0.5 * s)
+                         - std::exp(-0.5 * x) * blackscholes::normalCdf(x / s - 0.5 * s);
+        if (b > 1e-10)
+        {
+            xs.push_back(x);
+            targets.push_back(b);
+            exact.push_back(s);
+        }
+    }
+    using blackscholes::batch::Vec;
+    namespace stdx = std::experimental;
+    std::printf("%zu normalized quotes, worst relative error in vol sqrt(T):\n", xs.size());
+    for (int steps = 0; steps <= 4; ++steps)
+    {
+        double worst = 0.0;
+        for (std::size_t i = 0; i + Vec::size() <= xs.size(); i += Vec::size())
+        {
+            double s[Vec::size()];
+            blackscholes::batch::normalizedVol(Vec(&xs[i], stdx::element_aligned), Vec(&targets[i], stdx::element_aligned), steps)
+                .copy_to(s, stdx::element_aligned);
+            for (std::size_t k = 0; k < Vec::size(); ++k)
+            {
+                worst = std::max(worst, std::abs(s[k] / exact[i + k] - 1.0));
+            }
+        }
+        std::printf("  %d step(s)  %.2e%s\n", steps, worst, steps == blackscholes::batch::impliedVolSteps ? "   <- default" : "");
+    }
+
+    // 2. The whole surface through the public API, calls and puts, and its throughput.
+    std::vector<double> callVols(n), putVols(n);
+    const blackscholes::QuoteBatch callQuotes{spot, strike, rate, expiry, calls};
+    const blackscholes::QuoteBatch putQuotes{spot, strike, rate, expiry, puts};
+    double best = 1e300;
+    for (int repeat = 0; repeat < 5; ++repeat)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        blackscholes::callImpliedVols(callQuotes, callVols);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+    blackscholes::putImpliedVols(putQuotes, putVols);
+    std::printf("\n");
+    for (double floor : {1e-10, 1e-6})
+    {
+        double callError = 0.0, putError = 0.0, repriced = 0.0;
+        std::size_t counted = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (std::min(calls[i], puts[i]) < floor * spot[i])
+            {
+                continue;
+            }
+            ++counted;
+            callError = std::max(callError, std::abs(callVols[i] - vol[i]));
+            putError = std::max(putError, std::abs(putVols[i] - vol[i]));
+            repriced = std::max(repriced, std::abs(blackscholes::callPrice(spot[i], strike[i], rate[i], callVols[i], expiry[i]) - calls[i]));
+        }
+        std::printf("%zu quotes above %g of the spot: worst vol error %.2e (calls), %.2e (puts); worst repricing error %.2e\n",
+                    counted, floor, callError, putError, repriced);
+    }
+    std::printf("%.1f million implied vols per second on one core\n", static_cast<double>(n) / best / 1e6);
+
+    // 3. Quotes outside the no-arbitrage bounds.
+    const double badSpot[] = {100.0, 100.0, 100.0}, badStrike[] = {90.0, 100.0, 100.0}, zero[] = {0.0, 0.0, 0.0};
+    const double one[] = {1.0, 1.0, 1.0}, badPrice[] = {9.0, 100.5, 0.0};
+    double badVols[3];
+    blackscholes::callImpliedVols({badSpot, badStrike, zero, one, badPrice}, badVols);
+    std::printf("\nbelow intrinsic %g, above spot %g, zero %g\n", badVols[0], badVols[1], badVols[2]);
+}
+
+/*
+Build: g++ -std=c++20 -O2 -march=native main8.cpp -o main8
+
+Implied vols have no closed form, and the usual solvers (bisection, Brent, Newton until a
+tolerance) take a data-dependent number of iterations with branches on each option, which is what
+keeps them from vectorizing. Here every lane does exactly the same work: normalize, move to the
+out-of-the-money side by parity, take a closed-form guess, and run impliedVolSteps Halley steps,
+with masks only to keep a step positive and to turn arbitrage-violating quotes into NaN.
+
+The first section shows the fixed step count is enough: the error falls cubically and is at the
+level the price itself allows after three steps. A double price determines the vol of a far
+out-of-the-money quote only to a few digits (its vega is tiny), which is why the absolute vol
+error grows for the cheapest quotes while the repricing error stays at rounding level.
+*/
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <experimental/simd>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// A chain of vanilla calls and puts on one underlying, stored as contiguous strikes rather than as
+// one Payoff object per option. Option j pays max(sign_j (S - K_j), 0), sign +1 for a call and
+// -1 for a put, so a single spot is priced against the whole chain with one SIMD sweep across
+// strikes, and a Monte Carlo engine simulates the underlying once per chain instead of once per
+// option (see MCEngine::runSimulation(const OptionChain&)).
+//
+// The arrays are padded to a whole number of SIMD vectors with sign 0 options, which pay nothing.
+
+class OptionChain
+{
+public:
+    void addCall(double Strike) { add(Strike, 1.0); }
+    void addPut(double Strike) { add(Strike, -1.0); }
+
+    std::size_t size() const { return count; }
+    double strike(std::size_t j) const { return strikes[j]; }
+    bool isCall(std::size_t j) const { return signs[j] > 0.0; }
+
+    // out[j] = payoff of option j at this spot.
+    void evaluate(double Spot, std::span<double> out) const
+    {
+        checkSize(out.size());
+        const Vec s(Spot), zero(0.0);
+        for (std::size_t j = 0; j < strikes.size(); j += Vec::size())
+        {
+            store(std::experimental::max(Vec(&signs[j], aligned) * (s - Vec(&strikes[j], aligned)), zero), out, j);
+        }
+    }
+
+    // For every option j, adds payoff_j(S) - shift[j] to sum[j] and its square to sumSq[j], over all
+    // the spots. Shifting by a value close to the mean (the payoff at the forward, say) keeps the
+    // sum of squares from cancelling when it is turned into a variance.
+    void accumulate(std::span<const double> spots, std::span<const double> shift, std::span<double> sum,
+                    std::span<double> sumSq) const
+    {
+        checkSize(shift.size());
+        checkSize(sum.size());
+        checkSize(sumSq.size());
+        const Vec zero(0.0);
+        for (std::size_t j = 0; j < strikes.size(); j += Vec::size())
+        {
+            // One vector of strikes stays in registers for the whole batch of spots. Even and odd
+            // spots go to separate accumulators, so consecutive additions do not wait on each other.
+            const Vec k(&strikes[j], aligned), sign(&signs[j], aligned), offset = load(shift, j);
+            Vec s0(0.0), s1(0.0), q0(0.0), q1(0.0);
+            std::size_t i = 0;
+            for (; i + 1 < spots.size(); i += 2)
+            {
+                const Vec v0 = std::experimental::max(sign * (Vec(spots[i]) - k), zero) - offset;
+                const Vec v1 = std::experimental::max(sign * (Vec(spots[i + 1]) - k), zero) - offset;
+                s0 += v0;
+                q0 += v0 * v0;
+                s1 += v1;
+                q1 += v1 * v1;
+            }
+            if (i < spots.size())
+            {
+                const Vec v0 = std::experimental::max(sign * (Vec(spots[i]) - k), zero) - offset;
+                s0 += v0;
+                q0 += v0 * v0;
+            }
+            store(load(sum, j) + (s0 + s1), sum, j);
+            store(load(sumSq, j) + (q0 + q1), sumSq, j);
+        }
+    }
+
+private:
+    using Vec = std::experimental::native_simd<double>;
+    static constexpr auto aligned = std::experimental::element_aligned;
+
+    std::vector<double> strikes; // padded with sign 0 entries
+    std::vector<double> signs;
+    std::size_t count = 0;
+
+    void add(double Strike, double sign)
+    {
+        if (!(Strike >= 0.0))
+        {
+            throw std::invalid_argument("OptionChain: strikes must be non-negative");
+        }
+        if (count == strikes.size())
+        {
+            strikes.resize(count + Vec::size(), 0.0);
+            signs.resize(count + Vec::size(), 0.0);
+        }
+        strikes[count] = Strike;
+        signs[count] = sign;
+        ++count;
+    }
+
+    void checkSize(std::size_t n) const
+    {
+        if (n < count)
+        {
+            throw std::invalid_argument("OptionChain: span shorter than the chain");
+        }
+    }
+
+    // Loads and stores of user spans, which only have size() elements: the last vector goes
+    // through a full-width buffer.
+    Vec load(std::span<const double> in, std::size_t j) const
+    {
+        if (j + Vec::size() <= count)
+        {
+            return Vec(in.data() + j, aligned);
+        }
+        double buffer[Vec::size()] = {};
+        std::copy(in.begin() + j, in.begin() + count, buffer);
+        return Vec(buffer, aligned);
+    }
+
+    void store(const Vec& v, std::span<double> out, std::size_t j) const
+    {
+        if (j + Vec::size() <= count)
+        {
+            v.copy_to(out.data() + j, aligned);
+            return;
+        }
+        double buffer[Vec::size()];
+        v.copy_to(buffer, aligned);
+        std::copy(buffer, buffer + (count - j), out.begin() + j);
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+// The batch kernels use the Parallelism TS simd, which only libstdc++ ships complete; with another
+// standard library (libc++ on macOS) they fall back to a plain loop and the lesson still builds.
+#if __has_include(<experimental/simd>) && defined(__GLIBCXX__)
+#include <experimental/simd>
+#define PAYOFF_SIMD 1
+#else
+#define PAYOFF_SIMD 0
+#endif
+
+// Payoff is a polymorphic base class because it declares virtual functions
+// (operator() and clone) and is intended to be used via base class pointers.
+// According to Item 7, such classes MUST have a virtual destructor to ensure
+// derived destructors are called correctly when deleting via a base pointer.
+
+class Payoff
+{
+public:
+    Payoff() = default; // allows derived classes to construct Payoff
+    virtual double operator()(double Spot) const = 0;
+    // Pure virtual function makes this an abstract class — typical for polymorphic use.
+    virtual Payoff* clone() const = 0;
+    // clone is also virtual — used for polymorphic copying.
+
+    // Batch evaluation: one virtual dispatch for the whole span instead of one per spot.
+    // The default falls back to operator(), derived classes override it with a SIMD kernel.
+    // out may be the same span as spots (in-place evaluation).
+    virtual void evaluate(std::span<const double> spots, std::span<double> out) const
+    {
+        checkSizes(spots, out);
+        for (std::size_t i = 0; i < spots.size(); ++i)
+        {
+            out[i] = (*this)(spots[i]);
+        }
+    }
+
+    // Derivative with respect to the spot, used for pathwise sensitivities (item_08/aad.h).
+    // The default is a central finite difference; payoffs with a known derivative override it.
+    virtual double derivative(double Spot) const
+    {
+        const double h = 1e-6 * std::max(1.0, std::abs(Spot));
+        return ((*this)(Spot + h) - (*this)(Spot - h)) / (2.0 * h);
+    }
+
+    virtual ~Payoff() = 0;
+    // Virtual destructor is essential! Without it, deleting a derived object
+    // (e.g., PayoffCall or PayoffPut) through a Payoff* leads to undefined behavior.
+protected:
+    static void checkSizes(std::span<const double> spots, std::span<double> out)
+    {
+        if (out.size() < spots.size())
+        {
+            throw std::invalid_argument("Payoff::evaluate: output span is shorter than the spots");
+        }
+    }
+};
+
+inline Payoff::~Payoff() {} // virtual destructor needs to be declared
+
+namespace payoff_simd
+{
+// out[i] = max(spots[i]-Strike, 0) for a call, max(Strike-spots[i], 0) for a put: the same
+// subtraction as operator(), so a put at the strike gives +0.0 on both paths, not -0.0.
+#if PAYOFF_SIMD
+namespace stdx = std::experimental;
+using Vec = stdx::native_simd<double>;
+
+inline void vanilla(std::span<const double> spots, std::span<double> out, double Strike, bool call)
+{
+    const std::size_t n = spots.size();
+    const std::size_t w = Vec::size();
+    const Vec k(Strike), zero(0.0);
+    std::size_t i = 0;
+    for (; i + w <= n; i += w)
+    {
+        Vec x(spots.data() + i, stdx::element_aligned);
+        stdx::max(call ? x - k : k - x, zero).copy_to(out.data() + i, stdx::element_aligned);
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = std::max(call ? spots[i] - Strike : Strike - spots[i], 0.0);
+    }
+}
+#else
+inline void vanilla(std::span<const double> spots, std::span<double> out, double Strike, bool call)
+{
+    for (std::size_t i = 0; i < spots.size(); ++i)
+    {
+        out[i] = std::max(call ? spots[i] - Strike : Strike - spots[i], 0.0);
+    }
+}
+#endif
+} // namespace payoff_simd
+
+
+class PayoffCall : public Payoff
+{
+public:
+    PayoffCall(double Strike_) : Strike{Strike_} {}
+    virtual inline double operator()(double Spot) const override
+    {
+        return std::max(Spot-Strike,0.0);
+    }
+    virtual void evaluate(std::span<const double> spots, std::span<double> out) const override
+    {
+        checkSizes(spots, out);
+        payoff_simd::vanilla(spots, out, Strike, true);
+    }
+    virtual double derivative(double Spot) const override
+    {
+        return Spot > Strike ? 1.0 : 0.0;
+    }
+    virtual Payoff* clone() const override
+    {
+        return new PayoffCall(*this);
+    }
+    virtual ~PayoffCall() override {};
+    // Virtual destructor is needed to be declared, as the base class has a pure virtual destructor,
+    // in a case like this, one could define the base destructor and not override it.
+
+private:
+    double Strike;
+};
+
+class PayoffPut : public Payoff
+{
+public:
+    PayoffPut(double Strike_) : Strike{Strike_} {}
+    virtual inline double operator()(double Spot) const override
+    {
+        return std::max(Strike-Spot,0.0);
+    }
+    virtual void evaluate(std::span<const double> spots, std::span<double> out) const override
+    {
+        checkSizes(spots, out);
+        payoff_simd::vanilla(spots, out, Strike, false);
+    }
+    virtual double derivative(double Spot) const override
+    {
+        return Spot < Strike ? -1.0 : 0.0;
+    }
+    virtual Payoff* clone() const override
+    {
+        return new PayoffPut(*this);
+    }
+    virtual ~PayoffPut() override {};
+
+private:
+    double Strike;
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <experimental/simd>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include "payoff.h"
+
+// Expression templates for multi-leg payoffs. Call(95), Put(90), ... are leaves;
+// +, - and scalar * build a tree whose shape is a type, e.g.
+//
+//     2*Call(95) - Call(100) + Put(90)
+//     -> Sum<Diff<Scaled<Call>, Call>, Put>
+//
+// Nothing is evaluated while the tree is built. evaluate(expr, spots, out) then runs a single
+// loop over the spots in which the whole tree is inlined: no virtual calls and no per-leg buffers.
+// Every node evaluates one double through operator(), and bind() turns it into a mirror tree
+// working on SIMD registers with its constants (strikes, weights) broadcast once, before the loop.
+
+namespace payoff_expr
+{
+namespace stdx = std::experimental;
+using Vec = stdx::native_simd<double>;
+
+// CRTP tag so the operators below only pick up payoff expressions.
+template <typename E>
+struct Expr
+{
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+class Call : public Expr<Call>
+{
+public:
+    explicit Call(double Strike_) : Strike{Strike_} {}
+    double operator()(double Spot) const { return std::max(Spot - Strike, 0.0); }
+    struct Bound
+    {
+        Vec k, zero;
+        Vec operator()(const Vec& Spot) const { return stdx::max(Spot - k, zero); }
+    };
+    Bound bind() const { return {Vec(Strike), Vec(0.0)}; }
+private:
+    double Strike;
+};
+
+class Put : public Expr<Put>
+{
+public:
+    explicit Put(double Strike_) : Strike{Strike_} {}
+    double operator()(double Spot) const { return std::max(Strike - Spot, 0.0); }
+    struct Bound
+    {
+        Vec k, zero;
+        Vec operator()(const Vec& Spot) const { return stdx::max(k - Spot, zero); }
+    };
+    Bound bind() const { return {Vec(Strike), Vec(0.0)}; }
+private:
+    double Strike;
+};
+
+// Nodes hold their children by value: leaves are a double each, so a whole
+// butterfly is a few doubles and copying an expression is free.
+template <typename L, typename R>
+class Sum : public Expr<Sum<L, R>>
+{
+public:
+    Sum(const L& l_, const R& r_) : l{l_}, r{r_} {}
+    double operator()(double Spot) const { return l(Spot) + r(Spot); }
+    template <typename BL, typename BR>
+    struct Bound
+    {
+        BL l;
+        BR r;
+        Vec operator()(const Vec& Spot) const { return l(Spot) + r(Spot); }
+    };
+    auto bind() const { return Bound<decltype(l.bind()), decltype(r.bind())>{l.bind(), r.bind()}; }
+private:
+    L l;
+    R r;
+};
+
+template <typename L, typename R>
+class Diff : public Expr<Diff<L, R>>
+{
+public:
+    Diff(const L& l_, const R& r_) : l{l_}, r{r_} {}
+    double operator()(double Spot) const { return l(Spot) - r(Spot); }
+    template <typename BL, typename BR>
+    struct Bound
+    {
+        BL l;
+        BR r;
+        Vec operator()(const Vec& Spot) const { return l(Spot) - r(Spot); }
+    };
+    auto bind() const { return Bound<decltype(l.bind()), decltype(r.bind())>{l.bind(), r.bind()}; }
+private:
+    L l;
+    R r;
+};
+
+template <typename E>
+class Scaled : public Expr<Scaled<E>>
+{
+public:
+    Scaled(double weight_, const E& e_) : weight{weight_}, e{e_} {}
+    double operator()(double Spot) const { return weight * e(Spot); }
+    template <typename BE>
+    struct Bound
+    {
+        Vec w;
+        BE e;
+        Vec operator()(const Vec& Spot) const { return w * e(Spot); }
+    };
+    auto bind() const { return Bound<decltype(e.bind())>{Vec(weight), e.bind()}; }
+private:
+    double weight;
+    E e;
+};
+
+template <typename L, typename R>
+Sum<L, R> operator+(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+
+template <typename L, typename R>
+Diff<L, R> operator-(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+
+template <typename E>
+Scaled<E> operator*(double w, const Expr<E>& e) { return {w, e.self()}; }
+
+template <typename E>
+Scaled<E> operator*(const Expr<E>& e, double w) { return {w, e.self()}; }
+
+template <typename E>
+Scaled<E> operator-(const Expr<E>& e) { return {-1.0, e.self()}; }
+
+// One fused pass: each register of spots goes through the whole tree before the next one is loaded.
+template <typename E>
+void evaluate(const Expr<E>& expr, std::span<const double> spots, std::span<double> out)
+{
+    if (out.size() < spots.size())
+    {
+        throw std::invalid_argument("payoff_expr::evaluate: output span is shorter than the spots");
+    }
+    const E& e = expr.self();
+    const auto simd = e.bind();
+    const std::size_t n = spots.size();
+    const std::size_t w = Vec::size();
+    std::size_t i = 0;
+    for (; i + w <= n; i += w)
+    {
+        simd(Vec(spots.data() + i, stdx::element_aligned)).copy_to(out.data() + i, stdx::element_aligned);
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = e(spots[i]);
+    }
+}
+
+// Adapter for code that wants a Payoff: one virtual call per batch, then the fused loop.
+template <typename E>
+class PayoffExpr : public Payoff
+{
+public:
+    explicit PayoffExpr(const Expr<E>& expr_) : expr{expr_.self()} {}
+    double operator()(double Spot) const override { return expr(Spot); }
+    void evaluate(std::span<const double> spots, std::span<double> out) const override
+    {
+        payoff_expr::evaluate(expr, spots, out);
+    }
+    Payoff* clone() const override { return new PayoffExpr(*this); }
+private:
+    E expr;
+};
+
+template <typename E>
+PayoffExpr<E> makePayoff(const Expr<E>& expr) { return PayoffExpr<E>(expr); }
+
+} // namespace payoff_expr
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "payoff.h"
+
+// Value-semantic wrapper around any Payoff. Small concrete payoffs (PayoffCall, PayoffPut, ...)
+// are stored inline in the holder, so copying or moving a holder never touches the heap;
+// larger types, and payoffs only known through a Payoff&, fall back to clone().
+class PayoffHolder
+{
+public:
+    static constexpr std::size_t BufferSize = 48; // the whole holder is one 64-byte cache line
+
+    template <typename P, typename = std::enable_if_t<std::is_base_of_v<Payoff, std::decay_t<P>>>>
+    PayoffHolder(P&& payoff)
+    {
+        using T = std::decay_t<P>;
+        if constexpr (fitsInline<T>())
+        {
+            ptr = ::new (static_cast<void*>(buffer)) T(std::forward<P>(payoff));
+            ops = &inlineOps<T>;
+        }
+        else
+        {
+            ptr = new T(std::forward<P>(payoff));
+        }
+    }
+
+    // An empty holder, as one that has been moved from.
+    PayoffHolder() = default;
+
+    // Only the static type is known here, so the payoff is cloned onto the heap.
+    static PayoffHolder fromClone(const Payoff& payoff)
+    {
+        return PayoffHolder(payoff.clone());
+    }
+
+    PayoffHolder(const PayoffHolder& other)
+    {
+        if (other.ops)
+        {
+            ptr = other.ops->copy(other.ptr, buffer);
+            ops = other.ops;
+        }
+        else if (other.ptr)
+        {
+            ptr = other.ptr->clone();
+        }
+    }
+
+    PayoffHolder(PayoffHolder&& other) noexcept
+    {
+        steal(other);
+    }
+
+    PayoffHolder& operator=(const PayoffHolder& other)
+    {
+        if (this != &other)
+        {
+            PayoffHolder tmp(other); // copy first so a throwing clone leaves *this untouched
+            reset();
+            steal(tmp);
+        }
+        return *this;
+    }
+
+    PayoffHolder& operator=(PayoffHolder&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~PayoffHolder() { reset(); }
+
+    double operator()(double Spot) const { return (*ptr)(Spot); }
+    void evaluate(std::span<const double> spots, std::span<double> out) const { ptr->evaluate(spots, out); }
+
+    const Payoff& get() const { return *ptr; }
+    const Payoff* operator->() const { return ptr; }
+    const Payoff& operator*() const { return *ptr; }
+
+    bool isInline() const { return ops != nullptr; }
+    explicit operator bool() const { return ptr != nullptr; } // false when empty or moved from
+
+private:
+    // Type-specific operations for the inline case, one static table per stored type.
+    struct Ops
+    {
+        Payoff* (*copy)(const Payoff* src, void* dst);
+        Payoff* (*move)(Payoff* src, void* dst) noexcept;
+    };
+
+    template <typename T>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(T) <= BufferSize && alignof(T) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<T>;
+    }
+
+    template <typename T>
+    static constexpr Ops inlineOps{
+        [](const Payoff* src, void* dst) -> Payoff* { return ::new (dst) T(*static_cast<const T*>(src)); },
+        [](Payoff* src, void* dst) noexcept -> Payoff* { return ::new (dst) T(std::move(*static_cast<T*>(src))); }};
+
+    explicit PayoffHolder(Payoff* heap) : ptr{heap} {}
+
+    void steal(PayoffHolder& other) noexcept
+    {
+        if (other.ops)
+        {
+            ptr = other.ops->move(other.ptr, buffer);
+            ops = other.ops;
+            other.reset();
+        }
+        else
+        {
+            ptr = std::exchange(other.ptr, nullptr);
+            ops = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (ops)
+        {
+            ptr->~Payoff(); // virtual, as Item 7 demands
+        }
+        else
+        {
+            delete ptr;
+        }
+        ptr = nullptr;
+        ops = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char buffer[BufferSize];
+    Payoff* ptr = nullptr;     // points into buffer when inline, to the heap otherwise
+    const Ops* ops = nullptr;  // non-null exactly when the payoff is stored inline
+};
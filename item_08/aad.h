@@ -0,0 +1,200 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Reverse-mode algorithmic differentiation.
+//
+// Every operation on aad::Number appends a node to the active Tape: the indices of its (at most two)
+// arguments and the local partial derivatives with respect to them. One backward sweep over the tape
+// then yields the derivative of a result with respect to every input, whatever their number.
+//
+// The tape is an arena: nodes live in fixed-size chunks that are never moved or freed while the tape
+// is alive, and rewind() only resets a counter. A simulation can use it path by path: record the
+// inputs, take a mark, and for each path record, propagate, and rewind to the mark. The input
+// adjoints keep accumulating and the tape never grows beyond one path. Every operation still costs
+// a node, though; when the per-path computation is short and known, as in MCEngine::runGreeks, it
+// is cheaper to write its adjoint by hand and add the results to the adjoints of shared nodes.
+
+namespace aad
+{
+
+class Tape
+{
+public:
+    using Index = std::uint32_t;
+    static constexpr Index None = UINT32_MAX; // "not on the tape": a constant
+    static constexpr std::size_t ChunkSize = 1 << 14;
+
+    Tape() = default;
+    Tape(const Tape&) = delete;
+    Tape& operator=(const Tape&) = delete;
+
+    Index record(Index a, double da, Index b = None, double db = 0.0)
+    {
+        if (count == chunks.size() * ChunkSize)
+        {
+            if (count + ChunkSize > None)
+            {
+                throw std::length_error("aad::Tape: too many nodes");
+            }
+            chunks.push_back(std::make_unique<Node[]>(ChunkSize));
+        }
+        Node& n = node(count);
+        n = {0.0, {da, db}, {a, b}};
+        return static_cast<Index>(count++);
+    }
+
+    std::size_t mark() const { return count; }
+    void rewind(std::size_t to) { count = to; } // keeps the chunks for the next path
+
+    double& adjoint(Index i) { return node(i).adjoint; }
+
+    // Seeds d(result)/d(result) = 1 and sweeps back down to node `stop`. Nodes below stop
+    // (the inputs) receive their adjoints and keep them across calls.
+    void propagate(Index result, std::size_t stop = 0)
+    {
+        if (result == None)
+        {
+            return; // a constant result depends on nothing
+        }
+        node(result).adjoint += 1.0;
+        sweep(result + 1, stop);
+    }
+
+    // Pushes the adjoints of nodes [stop, end) to their arguments, from the last node down.
+    void sweep(std::size_t end, std::size_t stop)
+    {
+        for (std::size_t i = end; i-- > stop;)
+        {
+            const Node& n = node(i);
+            if (n.adjoint == 0.0)
+            {
+                continue;
+            }
+            for (int k = 0; k < 2; ++k)
+            {
+                if (n.parent[k] != None)
+                {
+                    node(n.parent[k]).adjoint += n.adjoint * n.partial[k];
+                }
+            }
+        }
+    }
+
+    // The tape new Numbers are recorded on, one per thread.
+    static Tape*& active()
+    {
+        thread_local Tape* tape = nullptr;
+        return tape;
+    }
+
+private:
+    struct Node
+    {
+        double adjoint;
+        double partial[2];
+        Index parent[2];
+    };
+
+    std::vector<std::unique_ptr<Node[]>> chunks;
+    std::size_t count = 0;
+
+    Node& node(std::size_t i) { return chunks[i / ChunkSize][i % ChunkSize]; }
+};
+
+// Makes a tape the active one for the current thread for the lifetime of the guard.
+class ActiveTape
+{
+public:
+    explicit ActiveTape(Tape& tape) : previous{Tape::active()} { Tape::active() = &tape; }
+    ~ActiveTape() { Tape::active() = previous; }
+    ActiveTape(const ActiveTape&) = delete;
+    ActiveTape& operator=(const ActiveTape&) = delete;
+private:
+    Tape* previous;
+};
+
+class Number
+{
+public:
+    Number(double value_ = 0.0) : value{value_} {} // a constant, not recorded
+
+    // A leaf on the active tape: its adjoint is what the backward sweep computes.
+    static Number input(double value_)
+    {
+        Number n(value_);
+        n.index = Tape::active()->record(Tape::None, 0.0);
+        return n;
+    }
+
+    // A node computed outside AAD (e.g. a virtual Payoff): f(x) with local derivative df/dx.
+    static Number apply(const Number& x, double fx, double dfdx) { return unary(fx, x, dfdx); }
+
+    double getValue() const { return value; }
+    Tape::Index getIndex() const { return index; }
+    double adjoint() const { return index == Tape::None ? 0.0 : Tape::active()->adjoint(index); }
+    void resetAdjoint() const
+    {
+        if (index != Tape::None)
+        {
+            Tape::active()->adjoint(index) = 0.0;
+        }
+    }
+
+    friend Number operator+(const Number& a, const Number& b) { return binary(a.value + b.value, a, 1.0, b, 1.0); }
+    friend Number operator-(const Number& a, const Number& b) { return binary(a.value - b.value, a, 1.0, b, -1.0); }
+    friend Number operator*(const Number& a, const Number& b) { return binary(a.value * b.value, a, b.value, b, a.value); }
+    friend Number operator/(const Number& a, const Number& b)
+    {
+        const double inv = 1.0 / b.value;
+        return binary(a.value * inv, a, inv, b, -a.value * inv * inv);
+    }
+    friend Number operator-(const Number& a) { return unary(-a.value, a, -1.0); }
+
+    friend Number exp(const Number& a)
+    {
+        const double e = std::exp(a.value);
+        return unary(e, a, e);
+    }
+    friend Number log(const Number& a) { return unary(std::log(a.value), a, 1.0 / a.value); }
+    friend Number sqrt(const Number& a)
+    {
+        const double s = std::sqrt(a.value);
+        return unary(s, a, 0.5 / s);
+    }
+
+private:
+    double value;
+    Tape::Index index = Tape::None;
+
+    static Number unary(double v, const Number& a, double da)
+    {
+        Number r(v);
+        if (a.index != Tape::None)
+        {
+            r.index = Tape::active()->record(a.index, da);
+        }
+        return r;
+    }
+
+    static Number binary(double v, const Number& a, double da, const Number& b, double db)
+    {
+        if (a.index == Tape::None)
+        {
+            return unary(v, b, db);
+        }
+        if (b.index == Tape::None)
+        {
+            return unary(v, a, da);
+        }
+        Number r(v);
+        r.index = Tape::active()->record(a.index, da, b.index, db);
+        return r;
+    }
+};
+
+} // namespace aad
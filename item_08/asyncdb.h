@@ -0,0 +1,772 @@
+#pragma once
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Asynchronous queries with C++20 coroutines: inside a Task, co_await conn.query(sql) suspends the
+// coroutine instead of blocking a thread, and one EventLoop thread drives every connection over
+// non-blocking sockets with epoll. A thread per in-flight query becomes a coroutine frame per
+// in-flight query, a few hundred bytes.
+//
+// LoopbackServer is the stand-in server for it: the same role as FakeServer, but listening on a
+// loopback TCP port, on its own thread and its own epoll loop, and delaying every reply by a
+// simulated round trip. Both sides speak one frame format, in host byte order:
+//
+//     u32 length of the rest | u64 query id | u8 status (0 ok, 1 error) | text
+//
+// Queries on a connection are pipelined: any number can be on the wire, and replies are matched to
+// their coroutines by id. Statements starting with "FAIL" get an error reply.
+
+namespace asyncdb
+{
+
+inline void setNonBlocking(int fd)
+{
+    if (::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        throw std::runtime_error(std::string("fcntl failed: ") + std::strerror(errno));
+    }
+}
+
+inline void appendFrame(std::string& out, std::uint64_t id, std::uint8_t status, const std::string& text)
+{
+    const std::uint32_t length = static_cast<std::uint32_t>(sizeof id + sizeof status + text.size());
+    out.append(reinterpret_cast<const char*>(&length), sizeof length);
+    out.append(reinterpret_cast<const char*>(&id), sizeof id);
+    out.push_back(static_cast<char>(status));
+    out += text;
+}
+
+// Calls f(id, status, text) for every complete frame at the front of in, then drops them.
+template <typename F>
+void takeFrames(std::string& in, F f)
+{
+    std::size_t at = 0;
+    for (;;)
+    {
+        std::uint32_t length;
+        if (in.size() - at < sizeof length)
+        {
+            break;
+        }
+        std::memcpy(&length, in.data() + at, sizeof length);
+        if (in.size() - at - sizeof length < length)
+        {
+            break;
+        }
+        std::uint64_t id;
+        std::memcpy(&id, in.data() + at + sizeof length, sizeof id);
+        const auto status = static_cast<std::uint8_t>(in[at + sizeof length + sizeof id]);
+        const std::size_t header = sizeof id + 1;
+        f(id, status, in.substr(at + sizeof length + header, length - header));
+        at += sizeof length + length;
+    }
+    in.erase(0, at);
+}
+
+// Reads what is available; returns false once the peer has closed or the socket failed.
+inline bool readSome(int fd, std::string& in)
+{
+    char buffer[64 * 1024];
+    for (;;)
+    {
+        const ssize_t n = ::read(fd, buffer, sizeof buffer);
+        if (n > 0)
+        {
+            in.append(buffer, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+// Writes what the socket takes; returns false if the socket failed. A peer that has gone away is
+// reported as a failure (EPIPE), not as SIGPIPE.
+inline bool writeSome(int fd, std::string& out)
+{
+    std::size_t done = 0;
+    while (done < out.size())
+    {
+        const ssize_t n = ::send(fd, out.data() + done, out.size() - done, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            done += static_cast<std::size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        return false;
+    }
+    out.erase(0, done);
+    return true;
+}
+
+class LoopbackServer
+{
+public:
+    explicit LoopbackServer(std::chrono::microseconds roundTrip_ = std::chrono::microseconds(0)) : roundTrip{roundTrip_}
+    {
+        listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t size = sizeof address;
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), size) != 0 || ::listen(listener, 1024) != 0
+            || ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &size) != 0)
+        {
+            const std::string error = std::strerror(errno);
+            closeDescriptors();
+            throw std::runtime_error("LoopbackServer: cannot listen: " + error);
+        }
+        portNumber = ntohs(address.sin_port);
+        epoll = ::epoll_create1(0);
+        wake = ::eventfd(0, EFD_NONBLOCK);
+        if (epoll < 0 || wake < 0)
+        {
+            const std::string error = std::strerror(errno);
+            closeDescriptors();
+            throw std::runtime_error("LoopbackServer: cannot create its event loop: " + error);
+        }
+        watch(listener, Listener, EPOLLIN);
+        watch(wake, Wake, EPOLLIN);
+        try
+        {
+            thread = std::thread([this] { serve(); });
+        }
+        catch (...)
+        {
+            closeDescriptors();
+            throw;
+        }
+    }
+
+    LoopbackServer(const LoopbackServer&) = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    ~LoopbackServer()
+    {
+        stopping = true;
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const ssize_t n = ::write(wake, &one, sizeof one);
+        thread.join();
+        for (auto& [key, conn] : connections)
+        {
+            ::close(conn.fd);
+        }
+        closeDescriptors();
+    }
+
+    std::uint16_t port() const { return portNumber; }
+    std::uint64_t totalQueries() const { return queries; }
+
+private:
+    static constexpr std::uint64_t Listener = 0;
+    static constexpr std::uint64_t Wake = 1;
+
+    struct Connection
+    {
+        int fd;
+        std::string in;
+        std::string out;
+        bool writable = true; // false while waiting for EPOLLOUT
+    };
+
+    struct Delayed
+    {
+        std::chrono::steady_clock::time_point due;
+        std::uint64_t connection;
+        std::uint64_t id;
+        std::uint8_t status;
+        std::string text;
+    };
+
+    std::chrono::microseconds roundTrip;
+    int listener = -1;
+    int epoll = -1;
+    int wake = -1;
+    std::uint16_t portNumber = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<std::uint64_t> queries{0};
+    std::thread thread;
+    // Server thread only:
+    std::unordered_map<std::uint64_t, Connection> connections; // by key, never reused
+    std::uint64_t nextKey = 2;
+    std::deque<Delayed> delayed; // one delay for all, so due times are in order
+
+    void closeDescriptors()
+    {
+        for (int fd : {listener, wake, epoll})
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    void watch(int fd, std::uint64_t key, std::uint32_t events, int op = EPOLL_CTL_ADD)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = key;
+        ::epoll_ctl(epoll, op, fd, &event);
+    }
+
+    void serve()
+    {
+        epoll_event events[256];
+        while (!stopping)
+        {
+            int timeout = -1;
+            if (!delayed.empty())
+            {
+                const auto wait = delayed.front().due - std::chrono::steady_clock::now();
+                timeout = static_cast<int>(std::max<std::int64_t>(0, std::chrono::ceil<std::chrono::milliseconds>(wait).count()));
+            }
+            const int n = ::epoll_wait(epoll, events, 256, timeout);
+            for (int i = 0; i < n; ++i)
+            {
+                const std::uint64_t key = events[i].data.u64;
+                if (key == Listener)
+                {
+                    accept();
+                }
+                else if (key != Wake)
+                {
+                    onEvents(key, events[i].events);
+                }
+            }
+            sendDue();
+        }
+    }
+
+    void accept()
+    {
+        for (;;)
+        {
+            const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0)
+            {
+                return;
+            }
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            const std::uint64_t key = nextKey++;
+            connections.emplace(key, Connection{fd, {}, {}});
+            watch(fd, key, EPOLLIN);
+        }
+    }
+
+    void onEvents(std::uint64_t key, std::uint32_t events)
+    {
+        const auto it = connections.find(key);
+        if (it == connections.end())
+        {
+            return;
+        }
+        Connection& conn = it->second;
+        if ((events & EPOLLOUT) && !flush(key, conn))
+        {
+            return;
+        }
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            const bool open = readSome(conn.fd, conn.in);
+            const auto due = std::chrono::steady_clock::now() + roundTrip;
+            takeFrames(conn.in, [&](std::uint64_t id, std::uint8_t, std::string sql)
+            {
+                ++queries;
+                if (sql.starts_with("FAIL"))
+                {
+                    delayed.push_back({due, key, id, 1, "DB statement rejected: " + sql});
+                }
+                else
+                {
+                    delayed.push_back({due, key, id, 0, "ok " + std::to_string(sql.size())});
+                }
+            });
+            if (!open)
+            {
+                drop(key);
+            }
+        }
+    }
+
+    void sendDue()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<std::uint64_t> touched;
+        while (!delayed.empty() && delayed.front().due <= now)
+        {
+            Delayed& d = delayed.front();
+            const auto it = connections.find(d.connection);
+            if (it != connections.end())
+            {
+                if (it->second.out.empty())
+                {
+                    touched.push_back(d.connection);
+                }
+                appendFrame(it->second.out, d.id, d.status, d.text);
+            }
+            delayed.pop_front();
+        }
+        for (std::uint64_t key : touched)
+        {
+            const auto it = connections.find(key);
+            if (it != connections.end() && it->second.writable)
+            {
+                flush(key, it->second);
+            }
+        }
+    }
+
+    // Returns false if the connection was dropped.
+    bool flush(std::uint64_t key, Connection& conn)
+    {
+        if (!writeSome(conn.fd, conn.out))
+        {
+            drop(key);
+            return false;
+        }
+        const bool writable = conn.out.empty();
+        if (writable != conn.writable)
+        {
+            conn.writable = writable;
+            watch(conn.fd, key, writable ? EPOLLIN : EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+        }
+        return true;
+    }
+
+    void drop(std::uint64_t key)
+    {
+        const auto it = connections.find(key);
+        ::epoll_ctl(epoll, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        ::close(it->second.fd);
+        connections.erase(it);
+    }
+};
+
+// Something the EventLoop calls back when its file descriptor is ready.
+class IoHandler
+{
+public:
+    virtual ~IoHandler() = default;
+    virtual void onEvents(std::uint32_t events) = 0;
+};
+
+// A single-threaded epoll loop. Everything registered with it, and every coroutine it resumes,
+// runs on the thread that calls run().
+class EventLoop
+{
+public:
+    EventLoop() : epoll{::epoll_create1(0)}
+    {
+        if (epoll < 0)
+        {
+            throw std::runtime_error(std::string("EventLoop: epoll_create1 failed: ") + std::strerror(errno));
+        }
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    ~EventLoop() { ::close(epoll); }
+
+    void watch(int fd, std::uint32_t events, IoHandler* handler, int op = EPOLL_CTL_ADD)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = handler;
+        if (::epoll_ctl(epoll, op, fd, &event) != 0)
+        {
+            throw std::runtime_error(std::string("EventLoop: epoll_ctl failed: ") + std::strerror(errno));
+        }
+    }
+
+    void unwatch(int fd) { ::epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr); }
+
+    // Resumes h from run() itself, before it next waits for events, rather than from the caller's
+    // stack: for code that must not resume coroutines while it is in the middle of an operation.
+    void defer(std::coroutine_handle<> h) { deferred.push_back(h); }
+
+    // Dispatches events until stop() is called from a handler or a coroutine on this loop.
+    void run()
+    {
+        running = true;
+        epoll_event events[256];
+        while (running)
+        {
+            for (std::coroutine_handle<> h : std::exchange(deferred, {}))
+            {
+                h.resume();
+            }
+            if (!running)
+            {
+                break;
+            }
+            const int n = ::epoll_wait(epoll, events, 256, deferred.empty() ? -1 : 0);
+            for (int i = 0; i < n && running; ++i)
+            {
+                static_cast<IoHandler*>(events[i].data.ptr)->onEvents(events[i].events);
+            }
+        }
+    }
+
+    void stop() { running = false; }
+
+private:
+    int epoll;
+    bool running = false;
+    std::vector<std::coroutine_handle<>> deferred;
+};
+
+// A lazily started coroutine returning T. co_await on a Task starts it and resumes the awaiting
+// coroutine when it finishes (its exception, if any, is rethrown there). spawn() starts a
+// Task<void> that nobody awaits.
+template <typename T>
+class Task;
+
+namespace detail
+{
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            return h.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase
+{
+    std::optional<T> value;
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T result()
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() {}
+    void result()
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+};
+} // namespace detail
+
+template <typename T>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> h_) : h{h_} {}
+    Task(Task&& o) noexcept : h{std::exchange(o.h, nullptr)} {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+
+    ~Task()
+    {
+        if (h)
+        {
+            h.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        h.promise().continuation = awaiting;
+        return h;
+    }
+
+    T await_resume() { return h.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> h;
+};
+
+template <typename T>
+Task<T> detail::Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+namespace detail
+{
+// Runs eagerly and frees itself at the end.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+inline Detached runDetached(Task<void> task)
+{
+    co_await task;
+}
+} // namespace detail
+
+// Starts task on the current thread until its first suspension. The task must handle its own
+// exceptions: one that escapes terminates the program, as it would from a std::thread.
+inline void spawn(Task<void> task)
+{
+    detail::runDetached(std::move(task));
+}
+
+// A client connection to a LoopbackServer, driven by an EventLoop. query() returns an awaitable;
+// co_await on it sends the statement and suspends until its reply, which it returns, or throws
+// std::runtime_error for an error reply or a lost connection. Only use it on the loop's thread.
+class AsyncDBConn : private IoHandler
+{
+public:
+    AsyncDBConn(EventLoop& loop_, std::uint16_t port) : loop{loop_}
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0)
+        {
+            const std::string error = std::strerror(errno);
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            throw std::runtime_error("AsyncDBConn: cannot connect: " + error);
+        }
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        setNonBlocking(fd);
+        loop.watch(fd, EPOLLIN, this);
+    }
+
+    AsyncDBConn(const AsyncDBConn&) = delete;
+    AsyncDBConn& operator=(const AsyncDBConn&) = delete;
+
+    // No query may still be waiting.
+    ~AsyncDBConn()
+    {
+        loop.unwatch(fd);
+        ::close(fd);
+    }
+
+    class Query
+    {
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            waiting = h;
+            return conn.send(*this); // false: failed at once, resume right away
+        }
+
+        std::string await_resume()
+        {
+            if (!ok)
+            {
+                throw std::runtime_error(reply);
+            }
+            return std::move(reply);
+        }
+
+    private:
+        friend class AsyncDBConn;
+        Query(AsyncDBConn& conn_, std::string sql_) : conn{conn_}, sql{std::move(sql_)} {}
+
+        AsyncDBConn& conn;
+        std::string sql;
+        std::coroutine_handle<> waiting;
+        bool ok = false;
+        std::string reply;
+    };
+
+    Query query(std::string sql) { return Query(*this, std::move(sql)); }
+
+    std::size_t inFlight() const { return pending.size(); }
+
+private:
+    EventLoop& loop;
+    int fd = -1;
+    bool broken = false;
+    bool writable = true; // false while waiting for EPOLLOUT
+    std::string in;
+    std::string out;
+    std::uint64_t nextId = 0;
+    std::unordered_map<std::uint64_t, Query*> pending; // the awaiters live in the suspended frames
+    std::vector<Query*> ready;
+
+    // Returns false if q failed without being sent, on a connection already lost; its coroutine then
+    // does not suspend.
+    bool send(Query& q)
+    {
+        if (broken)
+        {
+            q.reply = "AsyncDBConn: connection lost";
+            return false;
+        }
+        const std::uint64_t id = nextId++;
+        pending.emplace(id, &q);
+        const bool idle = out.empty();
+        appendFrame(out, id, 0, q.sql);
+        if (idle && writable)
+        {
+            flush();
+        }
+        if (broken)
+        {
+            // The write failed, and q is among the failed queries. They are resumed by the loop, not
+            // from here: we are inside q's await_suspend, and a resumed coroutine could call send()
+            // on this connection again before this call has returned.
+            for (Query* failed : std::exchange(ready, {}))
+            {
+                loop.defer(failed->waiting);
+            }
+        }
+        return true;
+    }
+
+    void flush()
+    {
+        if (!writeSome(fd, out))
+        {
+            fail();
+            return;
+        }
+        if (out.empty() != writable)
+        {
+            writable = out.empty();
+            loop.watch(fd, writable ? EPOLLIN : EPOLLIN | EPOLLOUT, this, EPOLL_CTL_MOD);
+        }
+    }
+
+    void onEvents(std::uint32_t events) override
+    {
+        if (events & EPOLLOUT)
+        {
+            flush();
+        }
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            const bool open = readSome(fd, in);
+            takeFrames(in, [this](std::uint64_t id, std::uint8_t status, std::string text)
+            {
+                const auto it = pending.find(id);
+                if (it != pending.end())
+                {
+                    it->second->ok = status == 0;
+                    it->second->reply = std::move(text);
+                    ready.push_back(it->second);
+                    pending.erase(it);
+                }
+            });
+            if (!open)
+            {
+                fail();
+            }
+        }
+        resumeReady();
+    }
+
+    // Every waiting query gets an error; later ones fail at once.
+    void fail()
+    {
+        if (broken)
+        {
+            return;
+        }
+        broken = true;
+        loop.unwatch(fd);
+        for (auto& [id, q] : pending)
+        {
+            q->reply = "AsyncDBConn: connection lost";
+            ready.push_back(q);
+        }
+        pending.clear();
+    }
+
+    // Resumed only after the buffers are consistent: a resumed coroutine may send its next query.
+    void resumeReady()
+    {
+        std::vector<Query*> now = std::exchange(ready, {});
+        for (Query* q : now)
+        {
+            q->waiting.resume();
+        }
+    }
+};
+
+} // namespace asyncdb
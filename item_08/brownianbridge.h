@@ -0,0 +1,138 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <experimental/simd>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Brownian bridge construction of W(t_1), ..., W(t_n) from n standard normals.
+//
+// The first normal sets the end point W(t_n), the second the midpoint, then the quarter points and
+// so on, each point drawn conditionally on its two already known neighbours:
+//
+//     W(t_m) = wl W(t_l) + wr W(t_r) + sigma Z,   wl = (t_r-t_m)/(t_r-t_l), wr = (t_m-t_l)/(t_r-t_l),
+//     sigma^2 = (t_m-t_l)(t_r-t_m)/(t_r-t_l)
+//
+// Most of the variance of the path is carried by the first few normals, which is where a Sobol
+// sequence is most uniform: path-dependent payoffs converge much faster than with the usual
+// step-by-step construction.
+//
+// Paths are processed in SoA layout: z and w are step-major matrices (row k holds dimension k of
+// every path), so each bridge step is one SIMD loop over contiguous paths.
+class BrownianBridge
+{
+public:
+    explicit BrownianBridge(const std::vector<double>& times_) : times{times_}
+    {
+        const std::size_t n = times.size();
+        if (n == 0)
+        {
+            throw std::invalid_argument("BrownianBridge: at least one time");
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (times[i] <= (i ? times[i - 1] : 0.0))
+            {
+                throw std::invalid_argument("BrownianBridge: times must be positive and increasing");
+            }
+        }
+        lastSigma = std::sqrt(times[n - 1]);
+        // Breadth-first bisection: coarse scales first.
+        std::deque<std::pair<long, long>> intervals{{-1, static_cast<long>(n) - 1}};
+        while (!intervals.empty())
+        {
+            auto [l, r] = intervals.front();
+            intervals.pop_front();
+            if (r - l < 2)
+            {
+                continue;
+            }
+            const long m = l + (r - l) / 2;
+            const double tl = l < 0 ? 0.0 : times[l];
+            const double tm = times[m];
+            const double tr = times[r];
+            steps.push_back({l, m, r, (tr - tm) / (tr - tl), (tm - tl) / (tr - tl), std::sqrt((tm - tl) * (tr - tm) / (tr - tl))});
+            intervals.push_back({l, m});
+            intervals.push_back({m, r});
+        }
+    }
+
+    std::size_t size() const { return times.size(); }
+
+    // z: size() rows of `paths` normals, w: size() rows of `paths` outputs (W at each time).
+    void buildPaths(const double* z, double* w, std::size_t paths) const
+    {
+        const std::size_t n = times.size();
+        double* last = w + (n - 1) * paths;
+        scaleRow(last, z, lastSigma, paths);
+        for (std::size_t k = 0; k < steps.size(); ++k)
+        {
+            const Step& s = steps[k];
+            const double* zk = z + (k + 1) * paths;
+            double* wm = w + s.mid * paths;
+            const double* wr = w + s.right * paths;
+            if (s.left < 0)
+            {
+                combineRow(wm, nullptr, 0.0, wr, s.rightWeight, zk, s.sigma, paths);
+            }
+            else
+            {
+                combineRow(wm, w + s.left * paths, s.leftWeight, wr, s.rightWeight, zk, s.sigma, paths);
+            }
+        }
+    }
+
+private:
+    struct Step
+    {
+        long left; // -1 means time 0, where W = 0
+        long mid;
+        long right;
+        double leftWeight;
+        double rightWeight;
+        double sigma;
+    };
+
+    using Vec = std::experimental::native_simd<double>;
+    static constexpr auto aligned = std::experimental::element_aligned;
+
+    std::vector<double> times;
+    std::vector<Step> steps;
+    double lastSigma = 0.0;
+
+    static void scaleRow(double* out, const double* z, double sigma, std::size_t paths)
+    {
+        const Vec s(sigma);
+        const std::size_t simdEnd = paths - paths % Vec::size();
+        for (std::size_t i = 0; i < simdEnd; i += Vec::size())
+        {
+            (s * Vec(z + i, aligned)).copy_to(out + i, aligned);
+        }
+        for (std::size_t i = simdEnd; i < paths; ++i)
+        {
+            out[i] = sigma * z[i];
+        }
+    }
+
+    static void combineRow(double* out, const double* left, double wl, const double* right, double wr, const double* z,
+                           double sigma, std::size_t paths)
+    {
+        const Vec vl(wl), vr(wr), s(sigma);
+        const std::size_t simdEnd = paths - paths % Vec::size();
+        for (std::size_t i = 0; i < simdEnd; i += Vec::size())
+        {
+            Vec x = vr * Vec(right + i, aligned) + s * Vec(z + i, aligned);
+            if (left)
+            {
+                x += vl * Vec(left + i, aligned);
+            }
+            x.copy_to(out + i, aligned);
+        }
+        for (std::size_t i = simdEnd; i < paths; ++i)
+        {
+            out[i] = wr * right[i] + sigma * z[i] + (left ? wl * left[i] : 0.0);
+        }
+    }
+};
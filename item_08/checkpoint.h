@@ -0,0 +1,189 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// FNV-1a, used both for run fingerprints and for checkpoint slot checksums.
+inline std::uint64_t fnv1a(const void* data, std::size_t n, std::uint64_t h = 0xcbf29ce484222325ull)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Memory-mapped checkpoint file for long simulations.
+//
+// The file holds two slots. save() fills the slot that is not current, checksums it, and only then
+// makes it current by bumping its sequence number, so a crash in the middle of a save leaves the
+// previous checkpoint intact. A save is a few hundred bytes of stores into the mapping plus one
+// msync of a single page, and it happens between rounds of blocks, never inside the path loop.
+//
+// The state itself is an opaque, trivially copyable blob chosen by the engine; the fingerprint
+// identifies the run (parameters, seed, ...) so a checkpoint is never resumed into another run.
+class Checkpoint
+{
+public:
+    static constexpr std::size_t MaxState = 256;
+
+    struct State
+    {
+        std::uint64_t nextBlock;           // blocks [0, nextBlock) are folded into state
+        std::vector<unsigned char> state;
+    };
+
+    Checkpoint(const std::string& path, std::uint64_t fingerprint_)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Checkpoint: cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Checkpoint: cannot stat " + path);
+        }
+        const bool fresh = st.st_size == 0;
+        if (fresh)
+        {
+            if (::ftruncate(fd, sizeof(File)) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Checkpoint: cannot size " + path);
+            }
+        }
+        else
+        {
+            // An existing file is checked before it is mapped writable, so that a wrong path is
+            // reported without its contents being touched.
+            Header header;
+            if (st.st_size != static_cast<off_t>(sizeof(File)) ||
+                ::pread(fd, &header, sizeof header, 0) != static_cast<ssize_t>(sizeof header) ||
+                std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version)
+            {
+                ::close(fd);
+                throw std::runtime_error("Checkpoint: " + path + " is not a checkpoint file");
+            }
+            if (header.fingerprint != fingerprint_)
+            {
+                ::close(fd);
+                throw std::runtime_error("Checkpoint: " + path + " belongs to a different simulation");
+            }
+        }
+        void* p = ::mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            throw std::runtime_error("Checkpoint: mmap failed for " + path);
+        }
+        file = static_cast<File*>(p);
+        if (fresh)
+        {
+            std::memset(file, 0, sizeof(File));
+            std::memcpy(file->header.magic, Magic, sizeof(Magic));
+            file->header.version = Version;
+            file->header.fingerprint = fingerprint_;
+            ::msync(file, sizeof(File), MS_SYNC);
+        }
+    }
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    ~Checkpoint() { ::munmap(file, sizeof(File)); }
+
+    // The most recent complete checkpoint, if any.
+    std::optional<State> load() const
+    {
+        const Slot* slot = current();
+        if (!slot)
+        {
+            return std::nullopt;
+        }
+        return State{slot->nextBlock, std::vector<unsigned char>(slot->state, slot->state + slot->stateSize)};
+    }
+
+    void save(std::uint64_t nextBlock, const void* state, std::size_t size)
+    {
+        if (size > MaxState)
+        {
+            throw std::length_error("Checkpoint: state too large");
+        }
+        const Slot* cur = current();
+        Slot& target = (cur == &file->slots[0]) ? file->slots[1] : file->slots[0];
+        target.sequence = 0; // invalid while being written
+        target.nextBlock = nextBlock;
+        target.stateSize = size;
+        std::memcpy(target.state, state, size);
+        target.checksum = slotChecksum(target);
+        std::atomic_thread_fence(std::memory_order_release); // the contents land before the sequence
+        target.sequence = (cur ? cur->sequence : 0) + 1;
+        ::msync(file, sizeof(File), MS_SYNC);
+    }
+
+private:
+    static constexpr char Magic[8] = {'M', 'C', 'C', 'K', 'P', 'T', '0', '1'};
+    static constexpr std::uint32_t Version = 1;
+
+    struct Slot
+    {
+        std::uint64_t sequence; // 0 = never written; the valid slot with the highest sequence is current
+        std::uint64_t nextBlock;
+        std::uint64_t stateSize;
+        std::uint64_t checksum;
+        unsigned char state[MaxState];
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t fingerprint;
+    };
+
+    struct File
+    {
+        Header header;
+        Slot slots[2];
+    };
+
+    File* file = nullptr;
+
+    static std::uint64_t slotChecksum(const Slot& s)
+    {
+        std::uint64_t h = fnv1a(&s.nextBlock, sizeof s.nextBlock);
+        h = fnv1a(&s.stateSize, sizeof s.stateSize, h);
+        return fnv1a(s.state, s.stateSize <= MaxState ? s.stateSize : 0, h);
+    }
+
+    static bool valid(const Slot& s)
+    {
+        return s.sequence != 0 && s.stateSize <= MaxState && s.checksum == slotChecksum(s);
+    }
+
+    const Slot* current() const
+    {
+        const Slot& a = file->slots[0];
+        const Slot& b = file->slots[1];
+        if (valid(a) && (!valid(b) || a.sequence > b.sequence))
+        {
+            return &a;
+        }
+        return valid(b) ? &b : nullptr;
+    }
+};
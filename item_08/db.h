@@ -0,0 +1,912 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "fakeserver.h"
+
+// DBConnection and its resource manager DBConn from main2.cpp, connected to a FakeServer, plus a
+// fixed-size ConnectionPool that hands out DBConn leases.
+//
+// DBConnection::create() opens a session, which costs a handshake with the server. A pool opens
+// its connections once and lends them out: a lease is a DBConn whose destructor returns the
+// connection to the pool instead of closing it. The free connections are kept on a lock-free
+// stack (a Treiber stack of slot indices with a version tag against ABA), and a counting
+// semaphore counts them, so acquire() only blocks when the pool is empty, and then with a timeout.
+//
+// Closing can be slow (the server may wait for in-flight work) and can fail. A DBConn given a
+// ConnectionReaper does not close in its destructor: it queues the connection, and the reaper's
+// thread closes it, retrying failures with backoff.
+//
+// Round trips, not server work, bound most write loads. DBConn::queue() collects statements and
+// flush() sends them in one round trip, each with its own future; GroupCommitter does the same for
+// writes from many threads, committing each group of them with a single COMMIT.
+//
+// Parsing is a large part of a short query's latency. DBConnection::execute() prepares each
+// distinct statement once per connection and keeps the handles in an LRU StatementCache, so a
+// pooled connection parses a statement the first time any lease runs it, and never again while
+// it stays cached. Handles belong to the server session: close() and reconnect() empty the cache.
+
+struct StatementCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t invalidations = 0; // cache emptied because the session ended, or a handle found unknown
+};
+
+// Least recently used map from normalized SQL to prepared statement handle. Normalizing collapses
+// every run of whitespace and comments outside quotes to one space and drops leading and trailing
+// whitespace and semicolons, so statements that differ only in layout share a handle. The
+// normalized text is only a key: the server is always sent the statement as written.
+class StatementCache
+{
+public:
+    explicit StatementCache(std::size_t capacity_) : capacity{std::max<std::size_t>(1, capacity_)} {}
+
+    static std::string normalize(const std::string& sql)
+    {
+        std::string out;
+        out.reserve(sql.size());
+        char quote = 0;
+        bool space = false;
+        for (std::size_t i = 0; i < sql.size(); ++i)
+        {
+            const char c = sql[i];
+            if (quote == 0)
+            {
+                if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                {
+                    space = true;
+                    continue;
+                }
+                if (sql.compare(i, 2, "--") == 0)
+                {
+                    i = std::min(sql.find('\n', i), sql.size());
+                    space = true;
+                    continue;
+                }
+                if (sql.compare(i, 2, "/*") == 0)
+                {
+                    const std::size_t end = sql.find("*/", i + 2);
+                    i = (end == std::string::npos) ? sql.size() : end + 1;
+                    space = true;
+                    continue;
+                }
+            }
+            if (space && !out.empty())
+            {
+                out.push_back(' ');
+            }
+            space = false;
+            if (c == '\'' || c == '"')
+            {
+                quote = (quote == 0) ? c : (quote == c ? 0 : quote);
+            }
+            out.push_back(c);
+        }
+        while (!out.empty() && (out.back() == ';' || out.back() == ' '))
+        {
+            out.pop_back();
+        }
+        return out;
+    }
+
+    // The cached handle, now the most recently used, or nothing.
+    std::optional<std::uint64_t> find(const std::string& key)
+    {
+        const auto it = index.find(key);
+        if (it == index.end())
+        {
+            ++counts.misses;
+            return std::nullopt;
+        }
+        ++counts.hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    // Adds a handle; returns the handle it evicted, which the caller deallocates on the server.
+    std::optional<std::uint64_t> insert(const std::string& key, std::uint64_t handle)
+    {
+        entries.emplace_front(key, handle);
+        index[key] = entries.begin();
+        if (entries.size() <= capacity)
+        {
+            return std::nullopt;
+        }
+        const std::uint64_t evicted = entries.back().second;
+        index.erase(entries.back().first);
+        entries.pop_back();
+        ++counts.evictions;
+        return evicted;
+    }
+
+    // Forgets one entry, whose handle the server no longer knows.
+    void erase(const std::string& key)
+    {
+        const auto it = index.find(key);
+        if (it != index.end())
+        {
+            entries.erase(it->second);
+            index.erase(it);
+            ++counts.invalidations;
+        }
+    }
+
+    void invalidate()
+    {
+        if (!entries.empty())
+        {
+            ++counts.invalidations;
+        }
+        entries.clear();
+        index.clear();
+    }
+
+    std::size_t size() const { return entries.size(); }
+    const StatementCacheStats& stats() const { return counts; }
+
+private:
+    std::size_t capacity;
+    std::list<std::pair<std::string, std::uint64_t>> entries; // most recently used first
+    std::unordered_map<std::string, std::list<std::pair<std::string, std::uint64_t>>::iterator> index;
+    StatementCacheStats counts;
+};
+
+class DBConnection
+{
+public:
+    static DBConnection create(FakeServer& server, std::size_t cacheCapacity = 64)
+    {
+        return DBConnection(server, server.connect(), cacheCapacity);
+    }
+
+    DBConnection(DBConnection&& o) noexcept
+        : server{o.server}, session{std::exchange(o.session, 0)}, cache(std::move(o.cache))
+    {
+    }
+
+    // An open connection is closed before it is overwritten, so that its session (and the prepared
+    // statements on it) does not leak; if that close throws, nothing is assigned.
+    DBConnection& operator=(DBConnection&& o)
+    {
+        if (this != &o)
+        {
+            close();
+            server = o.server;
+            session = std::exchange(o.session, 0);
+            cache = std::move(o.cache);
+        }
+        return *this;
+    }
+
+    std::string query(const std::string& sql)
+    {
+        if (!isOpen())
+        {
+            throw std::runtime_error("DBConnection: query on a closed connection");
+        }
+        return server->execute(session, sql);
+    }
+
+    // Runs sql as a prepared statement with these parameters, preparing it on a cache miss. A cached
+    // handle the server no longer knows is dropped and the statement prepared again.
+    std::string execute(const std::string& sql, const std::vector<std::string>& params = {})
+    {
+        if (!isOpen())
+        {
+            throw std::runtime_error("DBConnection: query on a closed connection");
+        }
+        const std::string key = StatementCache::normalize(sql);
+        if (const std::optional<std::uint64_t> handle = cache.find(key))
+        {
+            try
+            {
+                return server->executePrepared(session, *handle, params);
+            }
+            catch (const UnknownStatement&)
+            {
+                cache.erase(key);
+            }
+        }
+        auto [handle, result] = server->prepareAndExecute(session, sql, params);
+        if (const auto evicted = cache.insert(key, handle))
+        {
+            server->deallocate(session, *evicted);
+        }
+        return result;
+    }
+
+    const StatementCacheStats& cacheStats() const { return cache.stats(); }
+
+    // One round trip for all the statements; a rejected statement gets a Reply with ok false.
+    std::vector<Reply> executeBatch(const std::vector<std::string>& sql)
+    {
+        if (!isOpen())
+        {
+            throw std::runtime_error("DBConnection: query on a closed connection");
+        }
+        return server->executeBatch(session, sql);
+    }
+
+    // May throw; the connection then stays open and close() can be retried.
+    void close()
+    {
+        if (isOpen())
+        {
+            server->disconnect(session);
+            session = 0;
+            cache.invalidate();
+        }
+    }
+
+    void reconnect()
+    {
+        if (!isOpen())
+        {
+            cache.invalidate();
+            session = server->connect();
+        }
+    }
+
+    bool isOpen() const { return session != 0; }
+
+private:
+    DBConnection(FakeServer& server_, std::uint64_t session_, std::size_t cacheCapacity)
+        : server{&server_}, session{session_}, cache(cacheCapacity)
+    {
+    }
+
+    FakeServer* server;
+    std::uint64_t session; // 0 once closed
+    StatementCache cache;
+};
+
+// Counters of a ConnectionReaper; a snapshot, the reaper keeps counting.
+struct ReaperMetrics
+{
+    std::uint64_t submitted = 0;
+    std::uint64_t closed = 0;  // closed successfully, at the first attempt or a later one
+    std::uint64_t retries = 0; // failed attempts that were scheduled again
+    std::uint64_t failed = 0;  // given up after the last attempt
+    std::uint64_t pending = 0; // queued or waiting for a retry
+};
+
+// Closes connections on a background thread. submit() is a queue push; the thread closes what
+// was queued, and a failed close is retried after backoff, 2 backoff, 4 backoff... up to
+// maxAttempts attempts in all. A connection that still fails is given up: it is counted in
+// ReaperMetrics::failed and reported to the failure handler, with the last error.
+class ConnectionReaper
+{
+public:
+    // Runs on the reaper thread; exceptions it throws are ignored.
+    using FailureHandler = std::function<void(const std::string& error, unsigned attempts)>;
+
+    explicit ConnectionReaper(unsigned maxAttempts_ = 3, std::chrono::milliseconds backoff_ = std::chrono::milliseconds(10),
+                              FailureHandler onFailure_ = nullptr)
+        : maxAttempts{std::max(1u, maxAttempts_)}, backoff{backoff_}, onFailure{std::move(onFailure_)}
+    {
+        worker = std::thread([this] { reapLoop(); });
+    }
+
+    ConnectionReaper(const ConnectionReaper&) = delete;
+    ConnectionReaper& operator=(const ConnectionReaper&) = delete;
+
+    // Finishes every queued connection, retries included, before returning.
+    ~ConnectionReaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    void submit(DBConnection conn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push_back({std::move(conn), 0, {}});
+            ++counts.submitted;
+            ++counts.pending;
+        }
+        cv.notify_one();
+    }
+
+    // Blocks until nothing is queued or waiting for a retry.
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        idle.wait(lock, [this] { return counts.pending == 0; });
+    }
+
+    ReaperMetrics metrics() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return counts;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Item
+    {
+        DBConnection conn;
+        unsigned attempts;
+        Clock::time_point due;
+    };
+
+    unsigned maxAttempts;
+    std::chrono::milliseconds backoff;
+    FailureHandler onFailure;
+
+    mutable std::mutex m;
+    std::condition_variable cv;   // work queued or stopping
+    std::condition_variable idle; // pending dropped to zero
+    std::vector<Item> queue;      // submitted, not tried yet
+    std::vector<Item> retrying;   // reaper thread only
+    ReaperMetrics counts;
+    bool stopping = false;
+    std::thread worker;
+
+    void reapLoop()
+    {
+        std::vector<Item> batch;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                auto ready = [this] { return !queue.empty() || (stopping && retrying.empty()); };
+                if (retrying.empty())
+                {
+                    cv.wait(lock, ready);
+                }
+                else
+                {
+                    const auto next = std::min_element(retrying.begin(), retrying.end(),
+                                                       [](const Item& a, const Item& b) { return a.due < b.due; });
+                    cv.wait_until(lock, next->due, ready);
+                }
+                if (queue.empty() && retrying.empty()) // stopping and nothing left
+                {
+                    return;
+                }
+                std::swap(batch, queue);
+            }
+            // Retries that are due join the batch; the rest keep waiting.
+            const auto now = Clock::now();
+            for (auto it = retrying.begin(); it != retrying.end();)
+            {
+                if (it->due <= now)
+                {
+                    batch.push_back(std::move(*it));
+                    it = retrying.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            for (Item& item : batch)
+            {
+                attempt(item);
+            }
+            batch.clear();
+        }
+    }
+
+    void attempt(Item& item)
+    {
+        std::string error;
+        try
+        {
+            item.conn.close();
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        ++item.attempts;
+        bool done = true;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (error.empty())
+            {
+                ++counts.closed;
+            }
+            else if (item.attempts < maxAttempts)
+            {
+                ++counts.retries;
+                done = false;
+            }
+            else
+            {
+                ++counts.failed;
+            }
+        }
+        if (!done)
+        {
+            item.due = Clock::now() + backoff * (1 << std::min(item.attempts - 1, 20u));
+            retrying.push_back(std::move(item));
+            return;
+        }
+        if (!error.empty() && onFailure)
+        {
+            try
+            {
+                onFailure(error, item.attempts);
+            }
+            catch (...)
+            {
+            }
+        }
+        std::lock_guard<std::mutex> lock(m);
+        if (--counts.pending == 0)
+        {
+            idle.notify_all();
+        }
+    }
+};
+
+class PoolTimeout : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+class ConnectionPool;
+
+// Resource manager for DBConnection. It either owns its connection, and then the destructor
+// closes it if the client has not (itself, or through a ConnectionReaper), or leases one from a
+// ConnectionPool, and then the destructor gives it back. Closing a leased connection is allowed:
+// the pool reopens it before lending it again.
+class DBConn
+{
+public:
+    explicit DBConn(DBConnection conn) : owned(std::move(conn)) {}
+
+    // The destructor hands an unclosed connection to the reaper instead of closing it.
+    DBConn(DBConnection conn, ConnectionReaper& reaper_) : owned(std::move(conn)), reaper{&reaper_} {}
+
+    DBConn(DBConn&& o) noexcept
+        : owned(std::move(o.owned)), pool{std::exchange(o.pool, nullptr)}, slot{o.slot}, reaper{o.reaper}, closed{o.closed},
+          pendingSql(std::move(o.pendingSql)), pendingResults(std::move(o.pendingResults))
+    {
+    }
+
+    DBConn(const DBConn&) = delete;
+    DBConn& operator=(const DBConn&) = delete;
+    DBConn& operator=(DBConn&&) = delete;
+
+    ~DBConn();
+
+    DBConnection& connection();
+    DBConnection* operator->() { return &connection(); }
+
+    std::string query(const std::string& sql) { return connection().query(sql); }
+
+    void close()
+    {
+        connection().close(); // may throw
+        closed = true;
+    }
+
+    // Pipelining: statements are held until flush(), which sends them all in one round trip and
+    // completes their futures in order (a rejected statement's future throws). Statements still
+    // queued when the DBConn is destroyed are dropped, and their futures throw broken_promise.
+    std::future<std::string> queue(std::string sql)
+    {
+        pendingSql.push_back(std::move(sql));
+        pendingResults.emplace_back();
+        return pendingResults.back().get_future();
+    }
+
+    // If the round trip itself fails, every queued future gets the error and flush() rethrows it.
+    void flush()
+    {
+        if (pendingSql.empty())
+        {
+            return;
+        }
+        std::vector<std::string> sql = std::exchange(pendingSql, {});
+        std::vector<std::promise<std::string>> results = std::exchange(pendingResults, {});
+        std::vector<Reply> replies;
+        try
+        {
+            replies = connection().executeBatch(sql);
+        }
+        catch (...)
+        {
+            for (auto& result : results)
+            {
+                result.set_exception(std::current_exception());
+            }
+            throw;
+        }
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            if (replies[i].ok)
+            {
+                results[i].set_value(std::move(replies[i].text));
+            }
+            else
+            {
+                results[i].set_exception(std::make_exception_ptr(std::runtime_error(replies[i].text)));
+            }
+        }
+    }
+
+    std::size_t queued() const { return pendingSql.size(); }
+
+private:
+    friend class ConnectionPool;
+    DBConn(ConnectionPool& pool_, std::uint32_t slot_) : owned(std::nullopt), pool{&pool_}, slot{slot_} {}
+
+    std::optional<DBConnection> owned;
+    ConnectionPool* pool = nullptr; // set for leases
+    std::uint32_t slot = 0;
+    ConnectionReaper* reaper = nullptr;
+    bool closed = false;
+    std::vector<std::string> pendingSql;
+    std::vector<std::promise<std::string>> pendingResults;
+};
+
+class ConnectionPool
+{
+public:
+    // Opens size connections up front, each with its own statement cache.
+    ConnectionPool(FakeServer& server, std::size_t size, std::size_t cacheCapacity = 64)
+        : next(new std::atomic<std::uint32_t>[size]), available(static_cast<std::ptrdiff_t>(size))
+    {
+        if (size == 0 || size >= Empty)
+        {
+            throw std::invalid_argument("ConnectionPool: size must be between 1 and 2^32 - 2");
+        }
+        connections.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            connections.push_back(DBConnection::create(server, cacheCapacity));
+        }
+        for (std::size_t i = size; i-- > 0;)
+        {
+            push(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Every lease must have been returned by now.
+    ~ConnectionPool()
+    {
+        for (DBConnection& conn : connections)
+        {
+            try
+            {
+                conn.close();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "[ConnectionPool] ERROR closing a connection: " << e.what() << '\n';
+            }
+        }
+    }
+
+    // Waits up to timeout for a free connection; throws PoolTimeout if none came back in time.
+    template <typename Rep, typename Period>
+    DBConn acquire(std::chrono::duration<Rep, Period> timeout)
+    {
+        if (!available.try_acquire_for(timeout))
+        {
+            throw PoolTimeout("ConnectionPool: no connection became free before the timeout");
+        }
+        return lease(pop());
+    }
+
+    std::optional<DBConn> tryAcquire()
+    {
+        if (!available.try_acquire())
+        {
+            return std::nullopt;
+        }
+        return lease(pop());
+    }
+
+    std::size_t size() const { return connections.size(); }
+
+private:
+    friend class DBConn;
+    static constexpr std::uint32_t Empty = 0xFFFFFFFF;
+
+    std::vector<DBConnection> connections;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> next; // next[i]: the slot below i on the free stack
+    std::atomic<std::uint64_t> head{Empty};              // version << 32 | top slot
+    std::counting_semaphore<> available;                 // never more than the slots on the stack
+
+    DBConn lease(std::uint32_t slot)
+    {
+        try
+        {
+            connections[slot].reconnect(); // a client closed it during its last lease
+        }
+        catch (...)
+        {
+            release(slot);
+            throw;
+        }
+        return DBConn(*this, slot);
+    }
+
+    void release(std::uint32_t slot)
+    {
+        push(slot);
+        available.release();
+    }
+
+    // Called only with a permit from the semaphore, so the stack is never empty here.
+    std::uint32_t pop()
+    {
+        std::uint64_t h = head.load(std::memory_order_acquire);
+        for (;;)
+        {
+            const std::uint32_t top = static_cast<std::uint32_t>(h);
+            const std::uint64_t below = (((h >> 32) + 1) << 32) | next[top].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(h, below, std::memory_order_acquire, std::memory_order_acquire))
+            {
+                return top;
+            }
+        }
+    }
+
+    void push(std::uint32_t slot)
+    {
+        std::uint64_t h = head.load(std::memory_order_relaxed);
+        std::uint64_t top;
+        do
+        {
+            next[slot].store(static_cast<std::uint32_t>(h), std::memory_order_relaxed);
+            top = (((h >> 32) + 1) << 32) | slot;
+        } while (!head.compare_exchange_weak(h, top, std::memory_order_release, std::memory_order_relaxed));
+    }
+};
+
+inline DBConnection& DBConn::connection()
+{
+    return pool ? pool->connections[slot] : *owned;
+}
+
+inline DBConn::~DBConn()
+{
+    if (pool)
+    {
+        pool->release(slot);
+        return;
+    }
+    if (owned && !closed && owned->isOpen())
+    {
+        try
+        {
+            if (reaper)
+            {
+                reaper->submit(std::move(*owned));
+                return;
+            }
+            owned->close();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[DBConn] ERROR in destructor: " << e.what() << '\n';
+        }
+    }
+}
+
+// Group commit. Threads call write() and wait on the future; a committer thread with its own
+// connection takes everything written since its last round trip (up to maxGroup statements) and
+// sends it as BEGIN, the writes, COMMIT in one round trip. While one group is on the wire the next
+// one accumulates, so under load a single round trip and a single COMMIT serve many writers; with
+// a window, the committer also waits that long after the first write of a group for others to join.
+// A future completes once its write is committed. A rejected write aborts the group's transaction
+// on the server; it alone is failed with its error, and the rest of the group is sent again as a
+// new transaction. If the connection breaks, the group fails and the next one opens a new
+// connection.
+class GroupCommitter
+{
+public:
+    explicit GroupCommitter(FakeServer& server_, std::size_t maxGroup_ = 1024,
+                            std::chrono::microseconds window_ = std::chrono::microseconds(0))
+        : server{&server_}, conn(DBConnection::create(server_)), maxGroup{std::max<std::size_t>(1, maxGroup_)},
+          window{window_}
+    {
+        committer = std::thread([this] { commitLoop(); });
+    }
+
+    GroupCommitter(const GroupCommitter&) = delete;
+    GroupCommitter& operator=(const GroupCommitter&) = delete;
+
+    // Commits what has been written so far, then closes the connection.
+    ~GroupCommitter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        committer.join();
+        try
+        {
+            if (conn)
+            {
+                conn->close();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[GroupCommitter] ERROR closing the connection: " << e.what() << '\n';
+        }
+    }
+
+    std::future<std::string> write(std::string sql)
+    {
+        std::future<std::string> result;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (waiting.empty())
+            {
+                firstWrite = std::chrono::steady_clock::now();
+            }
+            waiting.push_back({std::move(sql), {}});
+            result = waiting.back().result.get_future();
+        }
+        cv.notify_one();
+        return result;
+    }
+
+    // Groups committed so far; writes / groups is the average group size.
+    std::uint64_t groups() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return groupCount;
+    }
+
+private:
+    struct Write
+    {
+        std::string sql;
+        std::promise<std::string> result;
+    };
+
+    FakeServer* server;
+    std::optional<DBConnection> conn; // committer thread only; empty after the connection broke
+    std::size_t maxGroup;
+    std::chrono::microseconds window;
+
+    mutable std::mutex m;
+    std::condition_variable cv;
+    std::vector<Write> waiting;
+    std::chrono::steady_clock::time_point firstWrite;
+    std::uint64_t groupCount = 0;
+    bool stopping = false;
+    std::thread committer;
+
+    void commitLoop()
+    {
+        std::vector<Write> group;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] { return stopping || !waiting.empty(); });
+                if (waiting.empty())
+                {
+                    return;
+                }
+                if (window.count() > 0)
+                {
+                    cv.wait_until(lock, firstWrite + window, [this] { return stopping || waiting.size() >= maxGroup; });
+                }
+                const std::size_t n = std::min(maxGroup, waiting.size());
+                std::move(waiting.begin(), waiting.begin() + n, std::back_inserter(group));
+                waiting.erase(waiting.begin(), waiting.begin() + n);
+                if (!waiting.empty())
+                {
+                    firstWrite = std::chrono::steady_clock::now();
+                }
+                ++groupCount;
+            }
+            commit(group);
+            group.clear();
+        }
+    }
+
+    void commit(std::vector<Write>& group)
+    {
+        std::vector<Write*> pending;
+        for (Write& w : group)
+        {
+            pending.push_back(&w);
+        }
+        std::vector<std::string> sql;
+        while (!pending.empty())
+        {
+            sql.clear();
+            sql.push_back("BEGIN");
+            for (const Write* w : pending)
+            {
+                sql.push_back(w->sql);
+            }
+            sql.push_back("COMMIT");
+            std::vector<Reply> replies;
+            try
+            {
+                if (!conn)
+                {
+                    conn.emplace(DBConnection::create(*server));
+                }
+                replies = conn->executeBatch(sql);
+            }
+            catch (...)
+            {
+                for (Write* w : pending)
+                {
+                    w->result.set_exception(std::current_exception());
+                }
+                dropConnection();
+                return;
+            }
+            if (replies.back().ok)
+            {
+                for (std::size_t i = 0; i < pending.size(); ++i)
+                {
+                    pending[i]->result.set_value(replies[i + 1].text);
+                }
+                return;
+            }
+            // The transaction was rolled back. The first rejected write caused it: fail that one
+            // and send the others again. If no write was rejected the COMMIT itself failed.
+            const auto rejected = std::find_if(replies.begin() + 1, replies.end() - 1, [](const Reply& r) { return !r.ok; });
+            if (rejected == replies.end() - 1)
+            {
+                for (Write* w : pending)
+                {
+                    w->result.set_exception(std::make_exception_ptr(std::runtime_error(replies.back().text)));
+                }
+                return;
+            }
+            const auto index = static_cast<std::size_t>(rejected - replies.begin() - 1);
+            pending[index]->result.set_exception(std::make_exception_ptr(std::runtime_error(rejected->text)));
+            pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+    }
+
+    // After a failed round trip the session is in an unknown state; the next group opens a new one.
+    void dropConnection()
+    {
+        try
+        {
+            conn->close();
+        }
+        catch (const std::exception&)
+        {
+            // The session is most likely gone already; the server reclaims it either way.
+        }
+        conn.reset();
+    }
+};
@@ -0,0 +1,308 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// An in-process stand-in for a database server, for the connection code of db.h. It keeps a set of
+// open sessions and answers every statement with a short string, and each operation sleeps for a
+// configurable latency so that benchmarks see the costs a real server would impose: a connection
+// handshake, a network round trip, parsing every statement it is sent as text, a COMMIT that waits
+// for the disk, and a close that can be slow or fail. Statements starting with "FAIL" are rejected.
+// As on a real server, a statement rejected inside BEGIN ... COMMIT aborts the transaction: the
+// statements after it are refused until COMMIT or ROLLBACK, and that COMMIT rolls everything back.
+//
+// Like real servers it also takes prepared statements: prepare() parses once and returns a handle
+// that belongs to the session, and executePrepared() runs it with parameters without parsing.
+
+struct ServerConfig
+{
+    std::chrono::microseconds connectLatency{0};
+    std::chrono::microseconds closeLatency{0};
+    std::chrono::microseconds roundTrip{0};
+    unsigned closeFailureEvery = 0; // every n-th close throws; 0 never
+    std::chrono::microseconds commitLatency{0};
+    std::chrono::microseconds parseCost{0}; // per statement sent as text or prepared
+};
+
+// Thrown by executePrepared() for a handle the session does not have (never prepared, deallocated,
+// or dropped by discardPrepared()); the caller can prepare the statement again.
+class UnknownStatement : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// The server's answer to one statement.
+struct Reply
+{
+    bool ok;
+    std::string text; // the result, or the error message
+};
+
+class FakeServer
+{
+public:
+    explicit FakeServer(ServerConfig config_ = {}) : config{config_} {}
+
+    FakeServer(const FakeServer&) = delete;
+    FakeServer& operator=(const FakeServer&) = delete;
+
+    std::uint64_t connect()
+    {
+        pause(config.connectLatency);
+        const std::uint64_t session = nextSession++;
+        std::lock_guard<std::mutex> lock(m);
+        sessions.emplace(session, Session{});
+        ++connects;
+        return session;
+    }
+
+    void disconnect(std::uint64_t session)
+    {
+        pause(config.closeLatency);
+        if (config.closeFailureEvery != 0 && ++closeAttempts % config.closeFailureEvery == 0)
+        {
+            throw std::runtime_error("DB close failed: simulated error");
+        }
+        std::lock_guard<std::mutex> lock(m);
+        if (sessions.erase(session) == 0)
+        {
+            throw std::runtime_error("DB close failed: unknown session");
+        }
+        std::erase_if(prepared, [session](const auto& entry) { return entry.second.session == session; });
+    }
+
+    std::string execute(std::uint64_t session, const std::string& sql)
+    {
+        const std::vector<Reply> replies = executeBatch(session, std::vector<std::string>{sql});
+        if (!replies[0].ok)
+        {
+            throw std::runtime_error(replies[0].text);
+        }
+        return replies[0].text;
+    }
+
+    // Several statements in one round trip, answered in order. Outside a transaction a rejected
+    // statement does not stop the ones after it; inside one it aborts the transaction.
+    std::vector<Reply> executeBatch(std::uint64_t session, const std::vector<std::string>& sql)
+    {
+        pause(config.roundTrip);
+        ++roundTrips;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (!sessions.contains(session))
+            {
+                throw std::runtime_error("DB query failed: session is not open");
+            }
+        }
+        std::vector<Reply> replies;
+        replies.reserve(sql.size());
+        for (const std::string& statement : sql)
+        {
+            ++statements;
+            replies.push_back(runStatement(session, statement));
+        }
+        return replies;
+    }
+
+    // Parses sql once, and runs it right away in the same round trip (as the parse, bind and
+    // execute messages of PostgreSQL's extended protocol travel together). The handle stays valid
+    // in this session until deallocate() or disconnect().
+    std::pair<std::uint64_t, std::string> prepareAndExecute(std::uint64_t session, const std::string& sql,
+                                                            const std::vector<std::string>& params)
+    {
+        pause(config.roundTrip);
+        ++roundTrips;
+        parse();
+        if (sql.starts_with("FAIL"))
+        {
+            throw std::runtime_error("DB prepare rejected: " + sql);
+        }
+        std::uint64_t handle;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (!sessions.contains(session))
+            {
+                throw std::runtime_error("DB prepare failed: session is not open");
+            }
+            handle = nextHandle++;
+            prepared.emplace(handle, Prepared{session, sql});
+        }
+        return {handle, run(handle, params)};
+    }
+
+    std::string executePrepared(std::uint64_t session, std::uint64_t handle, const std::vector<std::string>& params)
+    {
+        pause(config.roundTrip);
+        ++roundTrips;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            const auto it = prepared.find(handle);
+            if (it == prepared.end() || it->second.session != session)
+            {
+                throw UnknownStatement("DB execute failed: no such prepared statement in this session");
+            }
+        }
+        return run(handle, params);
+    }
+
+    // Real protocols send this along with the next request, so it costs no round trip here.
+    void deallocate(std::uint64_t session, std::uint64_t handle)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        const auto it = prepared.find(handle);
+        if (it != prepared.end() && it->second.session == session)
+        {
+            prepared.erase(it);
+        }
+    }
+
+    // Ends every session, as a server restart would: their connections get errors from then on.
+    void dropSessions()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        sessions.clear();
+        prepared.clear();
+    }
+
+    // Drops every prepared statement of every session, as DISCARD ALL or a failover to a replica
+    // would: their handles become unknown.
+    void discardPrepared()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        prepared.clear();
+    }
+
+    std::size_t preparedStatements() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return prepared.size();
+    }
+
+    std::size_t openSessions() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return sessions.size();
+    }
+
+    std::uint64_t totalConnects() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return connects;
+    }
+
+    std::uint64_t totalStatements() const { return statements; }
+    std::uint64_t totalRoundTrips() const { return roundTrips; }
+    std::uint64_t totalCommits() const { return commits; }
+    std::uint64_t totalParses() const { return parses; }
+
+private:
+    ServerConfig config;
+    std::atomic<std::uint64_t> nextSession{1};
+    std::atomic<std::uint64_t> closeAttempts{0};
+    std::atomic<std::uint64_t> statements{0};
+    std::atomic<std::uint64_t> roundTrips{0};
+    std::atomic<std::uint64_t> commits{0};
+    std::atomic<std::uint64_t> parses{0};
+
+    struct Session
+    {
+        bool inTransaction = false;
+        bool aborted = false; // a statement of the transaction was rejected
+    };
+
+    struct Prepared
+    {
+        std::uint64_t session;
+        std::string sql;
+    };
+
+    mutable std::mutex m;
+    std::unordered_map<std::uint64_t, Session> sessions;
+    std::unordered_map<std::uint64_t, Prepared> prepared; // by handle
+    std::uint64_t nextHandle = 1;
+    std::uint64_t connects = 0;
+
+    std::string run(std::uint64_t handle, const std::vector<std::string>& params)
+    {
+        ++statements;
+        std::size_t size = params.size();
+        {
+            std::lock_guard<std::mutex> lock(m);
+            size += prepared.at(handle).sql.size();
+        }
+        return "ok " + std::to_string(size);
+    }
+
+    Reply runStatement(std::uint64_t session, const std::string& statement)
+    {
+        if (transactionState(session).aborted && statement != "COMMIT" && statement != "ROLLBACK")
+        {
+            return {false, "DB statement rejected: current transaction is aborted"};
+        }
+        parse();
+        bool commit = false;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            const auto it = sessions.find(session);
+            if (it == sessions.end())
+            {
+                return {false, "DB query failed: session is not open"};
+            }
+            Session& state = it->second;
+            if (statement.starts_with("FAIL"))
+            {
+                state.aborted = state.inTransaction;
+                return {false, "DB statement rejected: " + statement};
+            }
+            if (statement == "BEGIN")
+            {
+                state.inTransaction = true;
+            }
+            else if (statement == "COMMIT" || statement == "ROLLBACK")
+            {
+                const bool aborted = state.aborted;
+                state = Session{};
+                if (statement == "COMMIT" && aborted)
+                {
+                    return {false, "DB commit failed: the transaction was aborted and rolled back"};
+                }
+                commit = statement == "COMMIT";
+            }
+        }
+        if (commit)
+        {
+            pause(config.commitLatency);
+            ++commits;
+        }
+        return {true, "ok " + std::to_string(statement.size())};
+    }
+
+    Session transactionState(std::uint64_t session) const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        const auto it = sessions.find(session);
+        return it == sessions.end() ? Session{} : it->second;
+    }
+
+    void parse()
+    {
+        pause(config.parseCost);
+        ++parses;
+    }
+
+    static void pause(std::chrono::microseconds latency)
+    {
+        if (latency.count() > 0)
+        {
+            std::this_thread::sleep_for(latency);
+        }
+    }
+};
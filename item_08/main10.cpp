@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "normal.h"
+#include "philox.h"
+
+constexpr std::size_t Block = 4096; // what MCEngine generates at a time
+const philox::Key key = philox::keyFromSeed(2024);
+
+double normalCdf(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+// Fills out with normals the way MCEngine does, a block at a time.
+void batchNormals(std::vector<double>& out)
+{
+    for (std::size_t b = 0; b * Block < out.size(); ++b)
+    {
+        double* p = out.data() + b * Block;
+        philox::fillUniforms(key, {0, static_cast<std::uint32_t>(b), 0, 0}, p, p + Block / 2, Block / 2);
+        normal::inverseCdf(p, p, Block);
+    }
+}
+
+// The generator MCEngine used before: one Philox call and one Box-Muller transform per pair.
+void scalarNormals(std::vector<double>& out)
+{
+    for (std::size_t i = 0; i < out.size(); i += 2)
+    {
+        const auto z = philox::normalPair({static_cast<std::uint32_t>(i / 2 % (Block / 2)), static_cast<std::uint32_t>(i / Block), 0, 0}, key);
+        out[i] = z[0];
+        out[i + 1] = z[1];
+    }
+}
+
+template <typename F>
+void bench(const char* name, std::vector<double>& out, F fill)
+{
+    fill(out); // warm up
+    const auto t0 = std::chrono::steady_clock::now();
+    const int reps = 5;
+    for (int r = 0; r < reps; ++r)
+    {
+        fill(out);
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / reps;
+    std::printf("%-34s %6.2f ns/value  %5.2f GB/s\n", name, 1e9 * s / out.size(), out.size() * sizeof(double) / s / 1e9);
+}
+
+int main()
+{
+    const std::size_t n = std::size_t{1} << 24;
+    std::vector<double> z(n);
+
+    // 1. The batch paths must reproduce the scalar functions.
+    {
+        const std::size_t m = 100003;
+        std::vector<double> first(m), second(m);
+        philox::fillUniforms(key, {7, 1, 2, 3}, first.data(), second.data(), m);
+        std::size_t mismatches = 0;
+        double worst = 0.0;
+        for (std::size_t i = 0; i < m; ++i)
+        {
+            const auto r = philox::philox4x32({static_cast<std::uint32_t>(7 + i), 1, 2, 3}, key);
+            mismatches += first[i] != philox::toUniform(r[0], r[1]) || second[i] != philox::toUniform(r[2], r[3]);
+        }
+        normal::inverseCdf(first.data(), second.data(), m);
+        for (std::size_t i = 0; i < m; ++i)
+        {
+            worst = std::max(worst, std::abs(second[i] - normal::inverseCdf(first[i])));
+        }
+        std::printf("fillUniforms vs scalar Philox: %zu mismatches in %zu counters\n", mismatches, m);
+        std::printf("batch vs scalar inverseCdf: max |difference| %.1e\n\n", worst);
+    }
+
+    // 2. Throughput.
+    std::vector<double> u(n);
+    bench("scalar Philox + Box-Muller", z, scalarNormals);
+    bench("fillUniforms", u, [](std::vector<double>& out) { philox::fillUniforms(key, {0, 0, 0, 0}, out.data(), out.data() + out.size() / 2, out.size() / 2); });
+    bench("inverseCdf (batch, in cache)", z, [&](std::vector<double>& out)
+    {
+        for (std::size_t b = 0; b < out.size(); b += Block)
+        {
+            normal::inverseCdf(u.data() + b, out.data() + b, Block);
+        }
+    });
+    bench("fillUniforms + inverseCdf", z, batchNormals);
+
+    // 3. Distribution quality of the batch normals.
+    batchNormals(z);
+    const double N = static_cast<double>(n);
+    double mean = 0.0;
+    for (double x : z)
+    {
+        mean += x;
+    }
+    mean /= N;
+    double m2 = 0.0, m3 = 0.0, m4 = 0.0, lag = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double d = z[i] - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+        m4 += d * d * d * d;
+        lag += i ? d * (z[i - 1] - mean) : 0.0;
+    }
+    m2 /= N;
+    m3 /= N;
+    m4 /= N;
+    std::printf("\n%zu normals           value      z-score\n", n);
+    std::printf("mean                 %+.6f   %+.2f\n", mean, mean / std::sqrt(1.0 / N));
+    std::printf("variance - 1         %+.6f   %+.2f\n", m2 - 1.0, (m2 - 1.0) / std::sqrt(2.0 / N));
+    std::printf("skewness             %+.6f   %+.2f\n", m3 / std::pow(m2, 1.5), m3 / std::pow(m2, 1.5) / std::sqrt(6.0 / N));
+    std::printf("excess kurtosis      %+.6f   %+.2f\n", m4 / (m2 * m2) - 3.0, (m4 / (m2 * m2) - 3.0) / std::sqrt(24.0 / N));
+    std::printf("lag-1 correlation    %+.6f   %+.2f\n", lag / (N * m2), lag / (N * m2) * std::sqrt(N));
+
+    // Chi-square over 1000 equiprobable bins, and tail frequencies.
+    const std::size_t bins = 1000;
+    std::vector<std::size_t> count(bins);
+    std::size_t beyond3 = 0, beyond4 = 0, beyond5 = 0;
+    for (double x : z)
+    {
+        ++count[std::min(bins - 1, static_cast<std::size_t>(normalCdf(x) * bins))];
+        beyond3 += std::abs(x) > 3.0;
+        beyond4 += std::abs(x) > 4.0;
+        beyond5 += std::abs(x) > 5.0;
+    }
+    double chi2 = 0.0;
+    for (std::size_t c : count)
+    {
+        const double e = N / bins;
+        chi2 += (c - e) * (c - e) / e;
+    }
+    std::printf("chi-square, %zu bins  %.1f      %+.2f (df %zu)\n", bins, chi2, (chi2 - (bins - 1)) / std::sqrt(2.0 * (bins - 1)), bins - 1);
+    std::printf("|z| > 3, 4, 5        %zu, %zu, %zu (expected %.0f, %.0f, %.1f)\n", beyond3, beyond4, beyond5,
+                N * 2.0 * normalCdf(-3.0), N * 2.0 * normalCdf(-4.0), N * 2.0 * normalCdf(-5.0));
+
+    // Kolmogorov-Smirnov.
+    std::sort(z.begin(), z.end());
+    double ks = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double f = normalCdf(z[i]);
+        ks = std::max({ks, f - i / N, (i + 1) / N - f});
+    }
+    std::printf("KS sqrt(n) D         %.3f      (5%% critical value 1.358)\n", ks * std::sqrt(N));
+    std::printf("min, max             %.3f, %.3f\n", z.front(), z.back());
+}
+
+/*
+Build: g++ -std=c++20 -O2 -march=native main10.cpp -o main10
+
+Normal generation used to be most of a terminal-spot Monte Carlo run: one Philox call, a log, a
+sqrt and a sin/cos per pair, all scalar. The batch pipeline splits it in two vectorized passes over
+a block that stays in L1:
+
+    * philox::fillUniforms runs four SIMD vectors of counters through the ten rounds at once. Each 32-bit
+      word sits in a 64-bit lane, so the 32x32->64 multiplies are ordinary lane multiplies, and the
+      uniforms are bitwise those of the scalar generator.
+    * normal::inverseCdf(u, z, n) evaluates Acklam's central rational function on whole vectors.
+      Only 4.85% of draws fall in a tail, but with 8 lanes about a third of vectors hold one; those
+      vectors also run the tail function on the whole vector, with item_07's fastmath log and sqrt,
+      and keep its lanes under the tail mask. A tail vector costs about five central ones; the
+      batch agrees with the scalar function to a few ulps.
+
+On the test machine (one AVX-512 core) this took inverseCdf from 2.1 GB/s, when tail lanes were
+patched with scalar log and sqrt, to 3.0 GB/s, and fillUniforms + inverseCdf from 1.35 to 1.6 GB/s.
+The pair is now bound by fillUniforms, about 2.7 GB/s on its own, so the end-to-end rate stays
+under the several GB/s per core that the inverse CDF alone approaches. Timings vary with the
+machine; the lines above are what this run measured.
+
+The inverse CDF also keeps one uniform per normal, which is what the Sobol path generator needs,
+so both generators now share the same transform. The statistics above are z-scores: values of a few
+units are what a correct generator produces, and the KS statistic stays below its critical value.
+Acklam's approximation has a relative error below 1.15e-9, far below what 2^24 draws can detect.
+*/
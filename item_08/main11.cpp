@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "mcengine.h"
+
+int main()
+{
+    // 1. Raw sums against Welford on payoffs with a large mean and a small spread.
+    {
+        std::vector<double> xs(1 << 20);
+        for (std::size_t i = 0; i < xs.size(); ++i)
+        {
+            xs[i] = 1e9 + static_cast<double>(i % 7) - 3.0;
+        }
+        double sum = 0.0, sumSq = 0.0;
+        for (double x : xs)
+        {
+            sum += x;
+            sumSq += x * x;
+        }
+        const double n = static_cast<double>(xs.size());
+        Welford exactOffsets; // the same sample without the offset, where raw sums are fine
+        for (double x : xs)
+        {
+            exactOffsets.add(x - 1e9);
+        }
+        const double exact = exactOffsets.variance();
+        Welford merged;
+        for (std::size_t b = 0; b < xs.size(); b += 4096)
+        {
+            merged.merge(Welford::of(std::span<const double>(xs).subspan(b, 4096)));
+        }
+        std::printf("variance of 1e9 + {-3..3}: raw sums %.6f, merged Welford %.6f (without the offset %.6f)\n\n",
+                    (sumSq - sum * sum / n) / (n - 1.0), merged.variance(), exact);
+    }
+
+    // 2. Early stopping: the path count is only a budget.
+    const MarketParams market{100.0, 0.05, 0.2, 1.0};
+    const std::uint64_t budget = 64 * 1000 * 1000;
+    std::printf("call K=100, budget %llu paths, Black-Scholes %.6f\n", static_cast<unsigned long long>(budget),
+                blackscholes::callPrice(100.0, 100.0, 0.05, 0.2, 1.0));
+    std::printf("%-16s %10s %12s %10s %10s %9s\n", "mode", "target", "paths", "price", "1.96 se", "ms");
+    for (auto mode : {VarianceReduction::None, VarianceReduction::ControlVariate})
+    {
+        for (double target : {0.05, 0.02, 0.01, 0.005})
+        {
+            MCEngine engine(PayoffCall(100.0), market, budget, 11);
+            engine.setVarianceReduction(mode, 110.0);
+            const auto t0 = std::chrono::steady_clock::now();
+            const MCResult r = engine.runSimulation(StoppingRule{target});
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            std::printf("%-16s %10.3f %12llu %10.5f %10.5f %9.1f\n", mode == VarianceReduction::None ? "plain" : "control variate",
+                        target, static_cast<unsigned long long>(r.paths), r.price, 1.96 * r.stdError, ms);
+        }
+    }
+
+    // 3. Where a run stops does not depend on the number of threads.
+    std::printf("\n");
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        const MCResult r = MCEngine(PayoffPut(95.0), market, budget, 5, threads).runSimulation(StoppingRule{0.01});
+        std::printf("%u thread(s): stopped after %llu paths, put %a\n", threads, static_cast<unsigned long long>(r.paths), r.price);
+    }
+}
+
+/*
+Build: g++ -std=c++20 -O2 -march=native -pthread main11.cpp -o main11
+
+A fixed path count is a guess at the accuracy a job needs, and usually a generous one. With a
+StoppingRule the count becomes a budget: blocks are simulated in rounds of blocksPerCheck, folded
+in block order, and the run ends at the first round where z * stdError is below the target. The
+worker threads are started once per run and meet at a barrier between rounds, where one of them
+folds the round and applies the rule, so a check costs a barrier rather than a thread start. The
+error falls as 1/sqrt(N), so halving the target costs four times the paths, and variance reduction
+reaches any target with proportionally fewer.
+
+Each block keeps Welford statistics (count, mean, sum of squared deviations) instead of sums of x
+and x^2. The first section shows why: with a mean of 1e9, x^2 is around 1e18 and its sum has no
+digits left for a variance of 4. The block statistics are computed in two passes over the block,
+already in cache, and merged with the exact pairwise formula. Merging in block order makes every
+check see bitwise the same statistics whatever the number of threads, so the stopping point and
+the price are reproducible.
+*/
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "db.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Opens count connections, forgets to close them, and returns the milliseconds their DBConn
+// destructors took.
+template <typename... Reaper>
+double destroyUnclosed(FakeServer& server, int count, Reaper&... reaper)
+{
+    std::vector<DBConn> conns;
+    for (int i = 0; i < count; ++i)
+    {
+        conns.emplace_back(DBConnection::create(server), reaper...);
+        conns.back().query("UPDATE accounts SET seen = 1");
+    }
+    const auto t0 = Clock::now();
+    conns.clear();
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+void print(const char* label, const ReaperMetrics& r)
+{
+    std::printf("%-28s submitted %llu, closed %llu, retries %llu, failed %llu, pending %llu\n", label,
+                static_cast<unsigned long long>(r.submitted), static_cast<unsigned long long>(r.closed),
+                static_cast<unsigned long long>(r.retries), static_cast<unsigned long long>(r.failed),
+                static_cast<unsigned long long>(r.pending));
+}
+
+int main()
+{
+    constexpr int count = 200;
+    ServerConfig config;
+    config.closeLatency = std::chrono::milliseconds(2);
+
+    // 1. Destructors that close the connection themselves wait for the server every time.
+    {
+        FakeServer server(config);
+        const double ms = destroyUnclosed(server, count); // no reaper
+        std::printf("closing in the destructor:   %7.2f ms for %d DBConns\n", ms, count);
+    }
+
+    // 2. With a reaper they only queue the connection. Every third close fails here and is retried.
+    {
+        config.closeFailureEvery = 3;
+        FakeServer server(config);
+        ConnectionReaper reaper(5, std::chrono::milliseconds(5));
+        const double ms = destroyUnclosed(server, count, reaper);
+        std::printf("handing over to the reaper:  %7.2f ms for %d DBConns\n", ms, count);
+        print("right after:", reaper.metrics());
+        reaper.drain();
+        print("after drain():", reaper.metrics());
+        std::printf("sessions still open on the server: %zu\n\n", server.openSessions());
+    }
+
+    // 3. A server that never lets go: the reaper gives up and tells the failure handler.
+    {
+        config.closeFailureEvery = 1;
+        FakeServer server(config);
+        ConnectionReaper reaper(4, std::chrono::milliseconds(1), [](const std::string& error, unsigned attempts)
+        {
+            std::printf("  failure handler: gave up after %u attempts: %s\n", attempts, error.c_str());
+        });
+        destroyUnclosed(server, 2, reaper);
+        reaper.drain();
+        print("closes that always fail:", reaper.metrics());
+    }
+}
+
+/*
+Build: g++ -std=c++20 -O2 -pthread main14.cpp -o main14
+
+main2.cpp closes a forgotten connection in the DBConn destructor and swallows the error, which is
+the right thing for correctness but puts the server's close latency on whatever thread destroys the
+DBConn, usually one serving a request. A DBConn constructed with a ConnectionReaper moves its open
+connection into the reaper's queue instead: the destructor costs one push under a mutex, and the
+slow part happens on the reaper thread.
+
+The reaper batches what it finds in the queue, and a close that throws is not retried on the spot:
+it is scheduled after an exponential backoff, so a struggling server is not hammered and the other
+queued connections are not held up behind it. Errors still never escape a destructor, but they are
+no longer only a line on stderr: ReaperMetrics counts closes, retries and connections given up, and
+the failure handler sees each one given up, with its last error, to log or alert on. The reaper's
+destructor finishes all pending work, retries included, so nothing queued is dropped at shutdown.
+*/
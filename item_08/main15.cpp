@@ -0,0 +1,189 @@
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "db.h"
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+int main()
+{
+    ServerConfig config;
+    config.roundTrip = std::chrono::microseconds(500);
+    config.commitLatency = std::chrono::microseconds(2000);
+
+    // 1. One connection, 1000 statements: a round trip each, or queued and flushed every 100.
+    {
+        FakeServer server(config);
+        DBConn conn(DBConnection::create(server));
+        constexpr int n = 1000;
+        auto t0 = Clock::now();
+        for (int i = 0; i < n; ++i)
+        {
+            conn.query("INSERT INTO ticks VALUES (" + std::to_string(i) + ")");
+        }
+        const double oneByOne = secondsSince(t0);
+        const auto tripsBefore = server.totalRoundTrips();
+        t0 = Clock::now();
+        std::vector<std::future<std::string>> results;
+        for (int i = 0; i < n; ++i)
+        {
+            results.push_back(conn.queue("INSERT INTO ticks VALUES (" + std::to_string(i) + ")"));
+            if (conn.queued() == 100)
+            {
+                conn.flush();
+            }
+        }
+        conn.flush();
+        for (auto& r : results)
+        {
+            r.get();
+        }
+        const double pipelined = secondsSince(t0);
+        std::printf("%d statements, 0.5 ms round trip: one by one %.0f ms, pipelined %.1f ms (%llu round trips)\n", n,
+                    1e3 * oneByOne, 1e3 * pipelined, static_cast<unsigned long long>(server.totalRoundTrips() - tripsBefore));
+
+        // A rejected statement fails its own future only.
+        auto good = conn.queue("INSERT INTO ticks VALUES (1)");
+        auto bad = conn.queue("FAIL this one");
+        auto after = conn.queue("INSERT INTO ticks VALUES (2)");
+        conn.flush();
+        try
+        {
+            bad.get();
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("in one flush: %s / \"%s\" / %s\n\n", good.get().c_str(), e.what(), after.get().c_str());
+        }
+    }
+
+    // 2. 64 writer threads, each write committed before the next, 2 ms per COMMIT on the server.
+    {
+        constexpr unsigned threads = 64;
+        constexpr int perThread = 20;
+        const double writes = threads * perThread;
+        auto runWriters = [&](auto writeOne)
+        {
+            const auto t0 = Clock::now();
+            std::vector<std::jthread> writers;
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                writers.emplace_back([&, t]
+                {
+                    for (int i = 0; i < perThread; ++i)
+                    {
+                        writeOne("INSERT INTO orders VALUES (" + std::to_string(t) + ", " + std::to_string(i) + ")");
+                    }
+                });
+            }
+            writers.clear();
+            return secondsSince(t0);
+        };
+
+        FakeServer plainServer(config);
+        double plain;
+        {
+            ConnectionPool pool(plainServer, 16);
+            plain = runWriters([&](const std::string& sql)
+            {
+                DBConn conn = pool.acquire(std::chrono::seconds(10));
+                conn.query("BEGIN");
+                conn.query(sql);
+                conn.query("COMMIT");
+            });
+        }
+        std::printf("%u writers, %.0f committed writes:\n", threads, writes);
+        std::printf("  own transaction each, pool of 16  %7.0f writes/s  %5llu round trips  %5llu commits\n", writes / plain,
+                    static_cast<unsigned long long>(plainServer.totalRoundTrips()),
+                    static_cast<unsigned long long>(plainServer.totalCommits()));
+
+        for (auto window : {std::chrono::microseconds(0), std::chrono::microseconds(1000)})
+        {
+            FakeServer server(config);
+            double grouped;
+            std::uint64_t groups;
+            {
+                GroupCommitter committer(server, 1024, window);
+                grouped = runWriters([&](const std::string& sql) { committer.write(sql).get(); });
+                groups = committer.groups();
+            }
+            std::printf("  group commit, %4lld us window      %7.0f writes/s  %5llu round trips  %5llu commits  (%.1f writes per group)\n",
+                        static_cast<long long>(window.count()), writes / grouped,
+                        static_cast<unsigned long long>(server.totalRoundTrips()),
+                        static_cast<unsigned long long>(server.totalCommits()), writes / static_cast<double>(groups));
+        }
+    }
+
+    // 3. A rejected write in a group, then a server restart under the committer.
+    {
+        FakeServer server(config);
+        GroupCommitter committer(server, 1024, std::chrono::microseconds(5000));
+        std::vector<std::future<std::string>> results;
+        for (int i = 0; i < 8; ++i)
+        {
+            results.push_back(committer.write(i == 3 ? "FAIL duplicate key" : "INSERT INTO orders VALUES (" + std::to_string(i) + ")"));
+        }
+        int committed = 0;
+        for (auto& r : results)
+        {
+            try
+            {
+                r.get();
+                ++committed;
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("\none group of 8 writes, one rejected: \"%s\"\n", e.what());
+            }
+        }
+        std::printf("  %d writes committed in %llu commits\n", committed, static_cast<unsigned long long>(server.totalCommits()));
+
+        server.dropSessions();
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            try
+            {
+                committer.write("INSERT INTO orders VALUES (100)").get();
+                std::printf("  after the restart, attempt %d: committed\n", attempt + 1);
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("  after the restart, attempt %d: \"%s\"\n", attempt + 1, e.what());
+            }
+        }
+    }
+}
+
+/*
+Build: g++ -std=c++20 -O2 -pthread main15.cpp -o main15
+
+When the server does little work per statement, the time of a write is the round trip to it, and
+for a committed write also the COMMIT's wait for the disk. Both can be shared.
+
+DBConn::queue() holds statements back and flush() sends them in one round trip; each statement
+gets its own future, so results and errors still arrive per statement (the FAIL statement in the
+first section fails alone). A thousand statements in batches of a hundred cost ten round trips
+instead of a thousand.
+
+GroupCommitter applies the same idea across threads. Writers only queue their statement and wait
+on its future; one committer thread sends whatever has accumulated as a single transaction, and
+while that round trip and its COMMIT are in flight the next group builds up. The busier the
+writers, the larger the groups, so throughput rises with load where one transaction per write
+saturates at (pool size) / (round trips + commit time). The optional window trades a little latency
+at low load for larger groups; at this load the groups fill on their own.
+
+Sharing a transaction means sharing its fate: on the server a rejected statement aborts the
+whole transaction, and the COMMIT that follows rolls it back. The committer fails only the write
+that was rejected and sends the rest of the group again as a new transaction, so in the third
+section seven of the eight writes are committed, at the cost of a second round trip for that
+group. When the connection itself breaks (the server restart), the writes of that group fail,
+and the next group opens a new connection instead of reusing the dead session.
+*/
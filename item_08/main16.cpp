@@ -0,0 +1,155 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "db.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Statement shapes of an application, the first ones much more frequent than the rest.
+std::vector<std::string> workload(std::size_t shapes, std::size_t n)
+{
+    std::vector<double> weights;
+    for (std::size_t k = 1; k <= shapes; ++k)
+    {
+        weights.push_back(1.0 / static_cast<double>(k));
+    }
+    std::mt19937 rng(42);
+    std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+    std::vector<std::string> sql;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        sql.push_back("SELECT * FROM table" + std::to_string(pick(rng)) + " WHERE id = $1");
+    }
+    return sql;
+}
+
+void print(const char* label, double ms, std::size_t n, const StatementCacheStats* stats, std::uint64_t parses)
+{
+    std::printf("  %-22s %6.0f us/statement  %5llu parses", label, 1e3 * ms / static_cast<double>(n),
+                static_cast<unsigned long long>(parses));
+    if (stats)
+    {
+        std::printf("  hits %llu, misses %llu, evictions %llu", static_cast<unsigned long long>(stats->hits),
+                    static_cast<unsigned long long>(stats->misses), static_cast<unsigned long long>(stats->evictions));
+    }
+    std::printf("\n");
+}
+
+int main()
+{
+    ServerConfig config;
+    config.roundTrip = std::chrono::microseconds(200);
+    config.parseCost = std::chrono::microseconds(100);
+    const std::vector<std::string> statements = workload(30, 1500);
+
+    // 1. One connection: every statement parsed, or prepared once and cached (large and small cache).
+    std::printf("%zu statements of 30 shapes, 200 us round trip, 100 us parse:\n", statements.size());
+    {
+        FakeServer server(config);
+        DBConnection conn = DBConnection::create(server);
+        const auto t0 = Clock::now();
+        for (const std::string& sql : statements)
+        {
+            conn.query(sql);
+        }
+        print("parsed every time", std::chrono::duration<double, std::milli>(Clock::now() - t0).count(), statements.size(), nullptr,
+              server.totalParses());
+    }
+    for (std::size_t capacity : {64, 8})
+    {
+        FakeServer server(config);
+        DBConnection conn = DBConnection::create(server, capacity);
+        const auto t0 = Clock::now();
+        for (std::size_t i = 0; i < statements.size(); ++i)
+        {
+            conn.execute(statements[i], {std::to_string(i)});
+        }
+        const std::string label = "cache of " + std::to_string(capacity);
+        print(label.c_str(), std::chrono::duration<double, std::milli>(Clock::now() - t0).count(), statements.size(),
+              &conn.cacheStats(), server.totalParses());
+    }
+
+    // 2. Layout does not matter, and a new session starts with an empty cache.
+    {
+        FakeServer server(config);
+        DBConnection conn = DBConnection::create(server);
+        conn.execute("SELECT name FROM users WHERE id = $1", {"1"});
+        conn.execute("  SELECT name\n    FROM users\n   WHERE id = $1;", {"2"});
+        conn.execute("SELECT name -- the display name\n  FROM users WHERE id = $1", {"3"});
+        conn.execute("SELECT name FROM users WHERE name = 'a  b'", {});
+        conn.execute("SELECT name FROM users WHERE name = 'a b'", {});
+        conn.execute("SELECT name -- FROM users WHERE name = 'a b'", {});
+        std::printf("\nlayout variants: hits %llu, misses %llu\n", static_cast<unsigned long long>(conn.cacheStats().hits),
+                    static_cast<unsigned long long>(conn.cacheStats().misses));
+        server.discardPrepared();
+        conn.execute("SELECT name FROM users WHERE id = $1", {"4"});
+        std::printf("after the server dropped its handles: invalidations %llu, handles on the server %zu\n",
+                    static_cast<unsigned long long>(conn.cacheStats().invalidations), server.preparedStatements());
+        conn.close();
+        conn.reconnect();
+        conn.execute("SELECT name FROM users WHERE id = $1", {"3"});
+        std::printf("after reconnect: misses %llu, invalidations %llu, handles on the server %zu\n",
+                    static_cast<unsigned long long>(conn.cacheStats().misses),
+                    static_cast<unsigned long long>(conn.cacheStats().invalidations), server.preparedStatements());
+    }
+
+    // 3. A pool: each connection warms up once, whichever lease runs the statement.
+    {
+        FakeServer server(config);
+        constexpr std::size_t poolSize = 4;
+        ConnectionPool pool(server, poolSize);
+        const std::vector<std::string> shapes = workload(10, 400);
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                threads.emplace_back([&, t]
+                {
+                    for (std::size_t i = t; i < shapes.size(); i += 16)
+                    {
+                        DBConn conn = pool.acquire(std::chrono::seconds(10));
+                        conn->execute(shapes[i], {std::to_string(i)});
+                    }
+                });
+            }
+        }
+        std::uint64_t hits = 0, misses = 0;
+        for (std::size_t k = 0; k < poolSize; ++k)
+        {
+            DBConn conn = pool.acquire(std::chrono::seconds(1));
+            hits += conn->cacheStats().hits;
+            misses += conn->cacheStats().misses;
+        }
+        std::printf("\npool of %zu, 16 threads, %zu statements of 10 shapes: %llu hits, %llu misses\n", poolSize, shapes.size(),
+                    static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses));
+    }
+}
+
+/*
+Build: g++ -std=c++20 -O2 -pthread main16.cpp -o main16
+
+A statement sent as text is parsed and planned by the server every time, even when the application
+only ever sends a few dozen distinct shapes with different parameters. DBConnection::execute()
+prepares a shape the first time the connection sees it and keeps the handle in a per-connection
+LRU cache keyed by the normalized text; later executions send only the handle and the parameters.
+A miss prepares and executes in the same round trip, so it costs no more than the text query.
+With a third of the latency in parsing, the first section's cached runs save nearly that third,
+and the small cache shows what happens when the working set does not fit: the rare shapes keep
+evicting each other, while the frequent ones stay at the front of the LRU list.
+
+The cache belongs to the connection, not to the lease, so a pooled connection keeps its handles
+from one lease to the next: in the third section the misses are bounded by pool size times
+shapes, however many requests run. Handles live in a server session, so close() and reconnect()
+empty the cache, and an evicted handle is deallocated on the server rather than left to pile up.
+
+The normalized text is only the cache key; the server is sent the statement as the caller wrote
+it, and normalizing skips comments and leaves quoted text alone, so two statements share a handle
+only if they differ in layout. In the second section the commented and the reformatted forms of
+the first query hit, the two literals differing in one space miss, and so does the last statement,
+where the comment runs to the end and leaves only SELECT name. When the server no longer knows a
+cached handle (after DISCARD ALL or a failover), execute() drops the entry and prepares again
+instead of failing the caller.
+*/
@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "asyncdb.h"
+
+using namespace asyncdb;
+
+struct Stats
+{
+    int finished = 0;
+    int total = 0;
+    std::size_t inFlight = 0;
+    std::size_t peakInFlight = 0;
+    int errors = 0;
+    EventLoop* loop = nullptr;
+};
+
+int threadsInProcess()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with("Threads:"))
+        {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+// A coroutine returning a value, awaited by another one.
+Task<std::string> lookup(AsyncDBConn& conn, int account, Stats& stats)
+{
+    ++stats.inFlight;
+    stats.peakInFlight = std::max(stats.peakInFlight, stats.inFlight);
+    std::string reply = co_await conn.query("SELECT balance FROM accounts WHERE id = " + std::to_string(account));
+    --stats.inFlight;
+    co_return reply;
+}
+
+// One client: a few queries in sequence, as a request handler would run them.
+Task<void> client(AsyncDBConn& conn, int id, int queries, Stats& stats)
+{
+    for (int q = 0; q < queries; ++q)
+    {
+        try
+        {
+            if (id % 1000 == 0 && q == 0)
+            {
+                co_await conn.query("FAIL on purpose");
+            }
+            co_await lookup(conn, id * queries + q, stats);
+        }
+        catch (const std::exception&)
+        {
+            ++stats.errors;
+        }
+    }
+    if (++stats.finished == stats.total)
+    {
+        stats.loop->stop();
+    }
+}
+
+int main()
+{
+    constexpr int clients = 10000;
+    constexpr int queriesPerClient = 10;
+    constexpr int connections = 16;
+    LoopbackServer server(std::chrono::milliseconds(2));
+    EventLoop loop;
+    std::vector<std::unique_ptr<AsyncDBConn>> conns;
+    for (int c = 0; c < connections; ++c)
+    {
+        conns.push_back(std::make_unique<AsyncDBConn>(loop, server.port()));
+    }
+
+    Stats stats;
+    stats.total = clients;
+    stats.loop = &loop;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < clients; ++i)
+    {
+        spawn(client(*conns[i % connections], i, queriesPerClient, stats));
+    }
+    const int threads = threadsInProcess();
+    loop.run();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::printf("%d coroutines x %d queries over %d loopback connections, 2 ms simulated round trip\n", clients, queriesPerClient,
+                connections);
+    std::printf("  peak in flight %zu, threads in the process %d (main/event loop + server)\n", stats.peakInFlight, threads);
+    std::printf("  %.2f s, %.0f queries/s, %llu queries answered by the server, %d error replies caught\n", seconds,
+                clients * queriesPerClient / seconds, static_cast<unsigned long long>(server.totalQueries()), stats.errors);
+}
+
+/*
+Build: g++ -std=c++20 -O2 -pthread main17.cpp -o main17
+
+With blocking calls, every query waiting for the server holds an OS thread and its stack, so ten
+thousand queries in flight mean ten thousand threads. Here a query in flight is a suspended
+coroutine: co_await conn.query(sql) writes the request, records the awaiter under the query's id
+and returns to the event loop. When epoll reports the socket readable, the loop reads every reply
+that arrived, matches each to its awaiter by id and resumes the coroutine, which continues right
+after its co_await with the result (or an exception for an error reply).
+
+All ten thousand clients run on the main thread; the only other thread is the stand-in server. The
+connections are pipelined, so sixteen sockets carry all the queries, and one read or write system
+call moves many frames. Task<T> composes like a function call (client awaits lookup, which awaits
+the query), and errors propagate through co_await as exceptions.
+*/
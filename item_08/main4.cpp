@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "workstealing.h"
+
+// A payoff whose evaluation fails, standing in for the engine of main.cpp
+// ("Simulation failed due to invalid parameters.").
+class PayoffInvalid : public Payoff
+{
+public:
+    double operator()(double) const override
+    {
+        throw std::runtime_error("Simulation failed due to invalid parameters.");
+    }
+    Payoff* clone() const override { return new PayoffInvalid(*this); }
+};
+
+void report(const char* title, const BatchResult& batch)
+{
+    std::cout << title << ": " << batch.count(BatchResult::Status::Succeeded) << " succeeded, "
+              << batch.count(BatchResult::Status::Failed) << " failed, "
+              << batch.count(BatchResult::Status::Cancelled) << " cancelled\n";
+    for (std::size_t i = 0; i < batch.entries.size(); ++i)
+    {
+        if (batch.entries[i].status == BatchResult::Status::Failed)
+        {
+            std::cout << "    engine " << i << ": " << batch.entries[i].message << "\n";
+        }
+    }
+}
+
+int main()
+{
+    const MarketParams market{100.0, 0.05, 0.2, 1.0};
+    WorkStealingPool pool;
+
+    std::vector<MCEngine> mces;
+    for (int i = 0; i < 16; ++i)
+    {
+        mces.emplace_back(PayoffCall(80.0 + 2.5 * i), market, 500000, i, 1);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    BatchResult clean = runSimulations(pool, mces);
+    auto t1 = std::chrono::steady_clock::now();
+    report("16 independent engines", clean);
+    std::cout << "    " << pool.size() << " worker(s), "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, first price "
+              << clean.entries[0].result->price << "\n";
+
+    mces[3] = MCEngine(PayoffInvalid(), market, 500000, 3, 1);
+    report("One failing engine, ContinueOnError", runSimulations(pool, mces));
+    report("One failing engine, CancelOnError", runSimulations(pool, mces, ErrorPolicy::CancelOnError));
+
+    std::cout << "[main] Program ended.\n";
+}
+
+/*
+Build: g++ -std=c++20 -O2 -pthread main4.cpp -o main4
+
+main.cpp runs its engines one after the other, lets runSimulation throw out of the loop, and then
+throws again from ~MCEngine while the stack is unwinding: std::terminate.
+
+Here the engines run concurrently on a work-stealing pool, and the batch never throws:
+
+    * each task catches whatever its engine throws and records it, with the exception_ptr,
+      in the BatchResult entry for that engine (the regular, non-destructor place to report
+      errors, as Item 8 recommends),
+    * with ErrorPolicy::CancelOnError the first failure triggers a shared stop_source; engines that
+      have not started are skipped and running ones stop at their next block boundary,
+    * engines do not write anything in their destructors.
+
+With fewer tasks than workers or very uneven tasks, idle workers steal from busy ones, so
+independent simulations keep all cores busy until the last one finishes.
+*/
@@ -0,0 +1,802 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+#include "../item_07/blackscholes.h"
+#include "../item_07/optionchain.h"
+#include "../item_07/payoffholder.h"
+#include "aad.h"
+#include "brownianbridge.h"
+#include "checkpoint.h"
+#include "normal.h"
+#include "pathpayoff.h"
+#include "philox.h"
+#include "resultwriter.h"
+#include "sobol.h"
+#include "welford.h"
+
+// Monte Carlo pricer for any Payoff from item_07, with terminal spots simulated under GBM:
+//
+//     S_T = S_0 exp((r - vol^2/2) T + vol sqrt(T) Z)
+//
+// Paths are grouped in fixed-size blocks. Block b always uses the Philox counters (i, b, 0),
+// so its normals, and therefore its partial sums, are the same whichever thread computes it.
+// Normals are made a block at a time: vectorized Philox uniforms through the vectorized inverse CDF.
+// Threads take blocks from a shared counter, and the partial sums are folded in block order at
+// the end: the price is bit-for-bit identical for any number of threads.
+
+struct MarketParams
+{
+    double Spot;
+    double Rate;
+    double Vol;
+    double Expiry;
+};
+
+// Thrown by runSimulation when its stop_token was triggered before all paths were simulated.
+class SimulationCancelled : public std::runtime_error
+{
+public:
+    SimulationCancelled() : std::runtime_error("MCEngine: simulation cancelled") {}
+};
+
+enum class VarianceReduction
+{
+    None,
+    Antithetic,    // paths come in pairs driven by Z and -Z
+    ControlVariate // regress on a PayoffCall whose price is known in closed form
+};
+
+// Price and first-order sensitivities from one pathwise adjoint run.
+struct MCGreeks
+{
+    double price;
+    double stdError;
+    double delta; // d price / d Spot
+    double vega;  // d price / d Vol
+    double rho;   // d price / d Rate
+    double theta; // -d price / d Expiry
+    std::uint64_t paths;
+};
+
+// Source of the normals driving path simulations.
+enum class PathGenerator
+{
+    Pseudo, // Philox normals
+    Sobol   // scrambled Sobol points through the inverse normal CDF
+};
+
+// Stops a run as soon as the confidence interval of the price is narrow enough. The engine's path
+// count becomes a budget: the run ends at the first check where z * stdError <= halfWidth, or when
+// the budget is spent. Checks happen every blocksPerCheck blocks, in block order, so where a run
+// stops depends on the seed and the rule but not on the number of threads.
+struct StoppingRule
+{
+    double halfWidth;                  // target half-width of the interval, in price units
+    double z = 1.96;                   // normal quantile: 1.96 for 95%, 2.576 for 99%
+    std::uint64_t minPaths = 1 << 16;  // the variance estimate is not trusted before this
+    std::uint64_t blocksPerCheck = 16;
+};
+
+struct MCResult
+{
+    double price;
+    double stdError;
+    std::uint64_t paths;
+    // Variance of the plain estimator over the variance of the one used, per payoff evaluation:
+    // the same standard error needs this many times fewer paths. 1 without variance reduction.
+    double varianceReductionFactor = 1.0;
+};
+
+class MCEngine
+{
+public:
+    static constexpr std::size_t BlockSize = 4096; // paths per block, even so normals come in pairs
+
+    MCEngine(const Payoff& payoff_, const MarketParams& market_, std::uint64_t paths_, std::uint64_t seed_ = 0,
+             unsigned threads_ = std::thread::hardware_concurrency())
+        : MCEngine(market_, paths_, seed_, threads_)
+    {
+        payoff = PayoffHolder::fromClone(payoff_);
+    }
+
+    // An engine without a payoff of its own, for the runs that take theirs as an argument: option
+    // chains and path payoffs. The runs that would use the engine's payoff throw std::logic_error.
+    MCEngine(const MarketParams& market_, std::uint64_t paths_, std::uint64_t seed_ = 0,
+             unsigned threads_ = std::thread::hardware_concurrency())
+        : market{market_}, paths{paths_}, seed{seed_}, threads{std::max(1u, threads_)}
+    {
+        if (market.Spot <= 0.0 || market.Vol < 0.0 || market.Expiry < 0.0)
+        {
+            throw std::invalid_argument("MCEngine: spot must be positive, vol and expiry non-negative");
+        }
+        if (paths == 0)
+        {
+            throw std::invalid_argument("MCEngine: at least one path is needed");
+        }
+    }
+
+    // Antithetic needs an even number of paths. ControlVariate uses PayoffCall(controlStrike_),
+    // priced with blackscholes::callPrice, as the control.
+    void setVarianceReduction(VarianceReduction mode_, double controlStrike_ = 0.0)
+    {
+        if (mode_ == VarianceReduction::Antithetic && paths % 2 != 0)
+        {
+            throw std::invalid_argument("MCEngine: antithetic variates need an even number of paths");
+        }
+        if (mode_ == VarianceReduction::ControlVariate && controlStrike_ <= 0.0)
+        {
+            throw std::invalid_argument("MCEngine: the control variate needs a positive strike");
+        }
+        mode = mode_;
+        controlStrike = controlStrike_;
+    }
+
+    // The stop_token is polled between blocks, so a cancelled run returns within one block.
+    MCResult runSimulation(std::stop_token stop = {}) const
+    {
+        return run(stop, nullptr);
+    }
+
+    // Prices every option of the chain from one set of paths: each block's terminal spots are
+    // simulated once and swept across all strikes, so the cost is one simulation plus one cheap
+    // SIMD pass per option, not one simulation per option. The engine's own payoff, if it has one,
+    // is not used.
+    // Plain estimator only (VarianceReduction::None); results are in chain order.
+    std::vector<MCResult> runSimulation(const OptionChain& chain, std::stop_token stop = {}) const
+    {
+        if (mode != VarianceReduction::None)
+        {
+            throw std::invalid_argument("MCEngine: option chains use the plain estimator");
+        }
+        const double forward = market.Spot * std::exp(market.Rate * market.Expiry);
+        std::vector<double> shift(chain.size());
+        chain.evaluate(forward, shift);
+        const std::uint64_t blocks = (paths + BlockSize - 1) / BlockSize;
+        std::vector<std::vector<Welford>> partial(blocks);
+        runBlocks(0, blocks, partial, stop, [&](std::uint64_t b, Scratch& scratch)
+        {
+            return simulateChainBlock(b, scratch, chain, shift);
+        });
+        std::vector<Welford> total(chain.size());
+        for (const std::vector<Welford>& block : partial) // block order, as everywhere else
+        {
+            for (std::size_t j = 0; j < chain.size(); ++j)
+            {
+                total[j].merge(block[j]);
+            }
+        }
+        const double discount = std::exp(-market.Rate * market.Expiry);
+        std::vector<MCResult> results;
+        for (const Welford& w : total)
+        {
+            results.push_back({discount * w.mean, discount * std::sqrt(w.variance() / static_cast<double>(w.count)), w.count, 1.0});
+        }
+        return results;
+    }
+
+    // Runs until the rule is met or the path budget is spent; MCResult::paths says how many were used.
+    MCResult runSimulation(const StoppingRule& rule, std::stop_token stop = {}) const
+    {
+        if (!(rule.halfWidth > 0.0) || !(rule.z > 0.0))
+        {
+            throw std::invalid_argument("MCEngine: the stopping rule needs a positive half-width and quantile");
+        }
+        return run(stop, nullptr, nullptr, 0, &rule);
+    }
+
+    // Same simulation, and every block's undiscounted path payoffs are handed to the writer as a
+    // record {uint64 block, uint64 count, double payoffs[count]}. Blocks arrive in completion order.
+    // The writer does the I/O on its own thread; check its close() status before shutting down.
+    MCResult runSimulation(ResultWriter& writer, std::stop_token stop = {}) const
+    {
+        return run(stop, &writer);
+    }
+
+    // Resumable run: starts from the checkpoint's last saved state, if it has one, and saves
+    // the accumulated sums every blocksPerCheckpoint blocks. When a run is cancelled or the process
+    // dies, calling this again with the same checkpoint file finishes the job, and the result is
+    // bitwise identical to an uninterrupted run. Build the Checkpoint with fingerprint().
+    MCResult runSimulation(Checkpoint& checkpoint, std::uint64_t blocksPerCheckpoint = 256, std::stop_token stop = {}) const
+    {
+        return run(stop, nullptr, &checkpoint, blocksPerCheckpoint);
+    }
+
+    // Path-dependent pricing: each path is observed at `steps` equally spaced dates up to Expiry and
+    // built with a Brownian bridge. With PathGenerator::Sobol the run is split into QmcReplications
+    // independently scrambled Sobol streams; the price is their average and the standard error comes
+    // from their spread (the path-by-path variance says nothing about quasi-random error).
+    MCResult runPathSimulation(const PathPayoff& pathPayoff, std::size_t steps, PathGenerator generator = PathGenerator::Sobol,
+                               std::stop_token stop = {}) const
+    {
+        if (steps == 0)
+        {
+            throw std::invalid_argument("MCEngine: at least one observation date");
+        }
+        std::vector<double> times(steps);
+        for (std::size_t k = 0; k < steps; ++k)
+        {
+            times[k] = market.Expiry * static_cast<double>(k + 1) / static_cast<double>(steps);
+        }
+        const BrownianBridge bridge(times);
+        std::optional<sobol::Directions> directions;
+        if (generator == PathGenerator::Sobol)
+        {
+            directions.emplace(static_cast<unsigned>(steps));
+        }
+        const std::uint64_t replications = generator == PathGenerator::Sobol ? QmcReplications : 1;
+        const std::uint64_t blocks = (paths + BlockSize - 1) / BlockSize;
+        std::vector<Welford> partial(blocks);
+        runBlocks(0, blocks, partial, stop, [&](std::uint64_t b, Scratch& scratch)
+        {
+            return simulatePathBlock(b, scratch, pathPayoff, bridge, times, directions ? &*directions : nullptr, replications);
+        });
+
+        std::vector<Welford> perReplication(replications);
+        for (std::uint64_t b = 0; b < blocks; ++b) // block order, as everywhere else
+        {
+            perReplication[b % replications].merge(partial[b]);
+        }
+        const double discount = std::exp(-market.Rate * market.Expiry);
+        if (replications == 1)
+        {
+            const Welford& w = perReplication[0];
+            return {discount * w.mean, discount * std::sqrt(w.variance() / static_cast<double>(w.count)), paths, 1.0};
+        }
+        Welford means;
+        for (const Welford& w : perReplication)
+        {
+            if (w.count > 0)
+            {
+                means.add(w.mean);
+            }
+        }
+        return {discount * means.mean, discount * std::sqrt(means.variance() / static_cast<double>(means.count)), paths, 1.0};
+    }
+
+    // Pathwise adjoint Greeks. The same paths as runSimulation, differentiated in reverse mode with
+    // Spot, Vol, Rate and Expiry as inputs: one backward pass gives all four sensitivities at once,
+    // for about the cost of the price alone (see simulateGreeksBlock).
+    // The payoff enters through Payoff::derivative, so pathwise Greeks need a payoff that is
+    // continuous in the spot (calls and puts are, digitals are not). Variance reduction is not applied.
+    MCGreeks runGreeks(std::stop_token stop = {}) const
+    {
+        requirePayoff();
+        const std::uint64_t blocks = (paths + BlockSize - 1) / BlockSize;
+        std::vector<GreekSums> partial(blocks);
+        runBlocks(0, blocks, partial, stop, [&](std::uint64_t b, Scratch& scratch) { return simulateGreeksBlock(b, scratch); });
+        GreekSums total;
+        for (const GreekSums& p : partial)
+        {
+            total.add(p);
+        }
+        const double n = static_cast<double>(paths);
+        return {total.value.mean, std::sqrt(total.value.variance() / n), total.dSpot / n, total.dVol / n, total.dRate / n,
+                -total.dExpiry / n, paths};
+    }
+
+    // Identifies everything the result depends on. The payoff is only visible through its virtual
+    // interface, so it is identified by its dynamic type and its values at a few probe spots.
+    std::uint64_t fingerprint() const
+    {
+        requirePayoff();
+        const std::uint64_t blockSize = BlockSize;
+        const std::uint64_t normalGenerator = NormalGenerator;
+        std::uint64_t h = fnv1a(&market, sizeof market);
+        h = fnv1a(&paths, sizeof paths, h);
+        h = fnv1a(&seed, sizeof seed, h);
+        h = fnv1a(&mode, sizeof mode, h);
+        h = fnv1a(&controlStrike, sizeof controlStrike, h);
+        h = fnv1a(&blockSize, sizeof blockSize, h);
+        h = fnv1a(&normalGenerator, sizeof normalGenerator, h);
+        const char* type = typeid(payoff.get()).name();
+        h = fnv1a(type, std::strlen(type), h);
+        for (double k : {0.25, 0.5, 0.8, 0.9, 1.0, 1.1, 1.25, 2.0, 4.0})
+        {
+            const double value = payoff(k * market.Spot);
+            h = fnv1a(&value, sizeof value, h);
+        }
+        return h;
+    }
+
+private:
+    // Statistics of one block: the undiscounted payoffs, the means of antithetic pairs, and the
+    // payoffs together with the control. Blocks merge in block order (see welford.h).
+    struct BlockStats
+    {
+        Welford value;
+        Welford pair;
+        WelfordCovariance control; // x: payoff, y: control
+
+        void add(const BlockStats& o)
+        {
+            value.merge(o.value);
+            pair.merge(o.pair);
+            control.merge(o.control);
+        }
+    };
+
+    // Discounted payoffs and sums of their pathwise derivatives over one block.
+    struct GreekSums
+    {
+        Welford value;
+        double dSpot = 0.0;
+        double dVol = 0.0;
+        double dRate = 0.0;
+        double dExpiry = 0.0;
+
+        void add(const GreekSums& o)
+        {
+            value.merge(o.value);
+            dSpot += o.dSpot;
+            dVol += o.dVol;
+            dRate += o.dRate;
+            dExpiry += o.dExpiry;
+        }
+    };
+
+    // Per-worker buffers, allocated once per run.
+    struct Scratch
+    {
+        std::vector<double> values = std::vector<double>(BlockSize);
+        std::vector<double> control = std::vector<double>(BlockSize);
+        std::vector<char> record;
+        std::vector<double> normals; // path simulation: steps x PathChunk matrices
+        std::vector<double> path;
+        std::vector<double> point;
+    };
+
+    static constexpr std::size_t PathChunk = 256;   // paths per bridge pass, keeps the matrices in cache
+    static constexpr std::uint64_t QmcReplications = 8;
+    static constexpr std::uint64_t NormalGenerator = 2; // bump when the map from counters to normals changes
+
+    PayoffHolder payoff;
+    MarketParams market;
+    std::uint64_t paths;
+    std::uint64_t seed;
+    unsigned threads;
+    VarianceReduction mode = VarianceReduction::None;
+    double controlStrike = 0.0;
+
+    MCResult run(std::stop_token stop, ResultWriter* writer, Checkpoint* checkpoint = nullptr,
+                 std::uint64_t blocksPerCheckpoint = 0, const StoppingRule* rule = nullptr) const
+    {
+        requirePayoff();
+        const std::uint64_t blocks = (paths + BlockSize - 1) / BlockSize;
+        BlockStats total;
+        std::uint64_t first = 0;
+        if (checkpoint)
+        {
+            if (auto saved = checkpoint->load())
+            {
+                if (saved->state.size() != sizeof(BlockStats) || saved->nextBlock > blocks)
+                {
+                    throw std::runtime_error("MCEngine: checkpoint does not match this engine");
+                }
+                std::memcpy(&total, saved->state.data(), sizeof(BlockStats));
+                first = saved->nextBlock;
+            }
+        }
+        // Blocks are simulated in rounds and folded into total in block order after each round,
+        // which is exactly the order of a single uninterrupted pass: resuming from a round
+        // boundary gives bitwise the same result, and a stopping rule sees the same statistics
+        // at every check whatever the number of threads.
+        const std::uint64_t round = checkpoint ? std::max<std::uint64_t>(1, blocksPerCheckpoint)
+                                  : rule     ? std::max<std::uint64_t>(1, rule->blocksPerCheck)
+                                             : blocks;
+        std::vector<BlockStats> partial(std::min(round, blocks));
+        runRounds(first, blocks, round, partial, stop, [&](std::uint64_t b, Scratch& scratch)
+        {
+            BlockStats sums = simulateBlock(b, scratch);
+            if (writer)
+            {
+                writeBlock(*writer, b, scratch);
+            }
+            return sums;
+        },
+        [&](std::uint64_t begin, std::uint64_t end)
+        {
+            for (std::uint64_t b = begin; b < end; ++b)
+            {
+                total.add(partial[b - begin]);
+            }
+            if (checkpoint)
+            {
+                checkpoint->save(end, &total, sizeof total);
+            }
+            return !(rule && total.value.count >= rule->minPaths && rule->z * summarize(total).stdError <= rule->halfWidth);
+        });
+        return summarize(total);
+    }
+
+    void requirePayoff() const
+    {
+        if (!payoff)
+        {
+            throw std::logic_error("MCEngine: this run needs an engine built with a payoff");
+        }
+    }
+
+    // Simulates blocks [begin, end) on up to `threads` threads into partial[b - begin];
+    // simulate(b, scratch) computes one block.
+    template <typename Sums, typename Simulate>
+    void runBlocks(std::uint64_t begin, std::uint64_t end, std::vector<Sums>& partial, std::stop_token stop,
+                   Simulate&& simulate) const
+    {
+        runRounds(begin, end, end - begin, partial, stop, simulate, [](std::uint64_t, std::uint64_t) { return true; });
+    }
+
+    // runBlocks in rounds of `round` blocks, partial indexed from the round's first block. Between
+    // rounds, with every worker waiting, onRound(roundBegin, roundEnd) consumes partial and returns
+    // false to end the run early. The workers (and their Scratch) are started once for the whole
+    // run, so a round costs a barrier, not a thread start and join per worker.
+    template <typename Sums, typename Simulate, typename OnRound>
+    void runRounds(std::uint64_t begin, std::uint64_t end, std::uint64_t round, std::vector<Sums>& partial,
+                   std::stop_token stop, Simulate&& simulate, OnRound&& onRound) const
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        // Only changed by endRound, while every worker waits at the barrier.
+        std::uint64_t roundBegin = begin;
+        std::uint64_t roundEnd = std::min(end, begin + round);
+        bool finished = false;
+        bool cancelled = false;
+        std::atomic<std::uint64_t> next{begin};
+        std::atomic<std::uint64_t> done{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+        // An exception must not escape a std::thread (that is std::terminate), so the first one is
+        // kept, the other workers stop, and it is rethrown on the calling thread.
+        auto keepFailure = [&]
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+            {
+                failure = std::current_exception();
+            }
+            failed = true;
+        };
+        auto endRound = [&]() noexcept
+        {
+            if (failed || done != roundEnd - roundBegin)
+            {
+                cancelled = !failed;
+                finished = true;
+                return;
+            }
+            try
+            {
+                finished = !onRound(roundBegin, roundEnd) || roundEnd == end;
+            }
+            catch (...)
+            {
+                keepFailure();
+                finished = true;
+                return;
+            }
+            roundBegin = roundEnd;
+            roundEnd = std::min(end, roundBegin + round);
+            done = 0;
+            next = roundBegin;
+        };
+        const auto crew = static_cast<std::ptrdiff_t>(std::min<std::uint64_t>(threads, std::min(round, end - begin)));
+        std::barrier sync(crew, endRound);
+        auto worker = [&]
+        {
+            std::optional<Scratch> scratch;
+            while (!finished)
+            {
+                try
+                {
+                    if (!scratch)
+                    {
+                        scratch.emplace();
+                    }
+                    for (std::uint64_t b = next++; b < roundEnd && !stop.stop_requested() && !failed; b = next++)
+                    {
+                        partial[b - roundBegin] = simulate(b, *scratch);
+                        ++done;
+                    }
+                }
+                catch (...)
+                {
+                    keepFailure();
+                }
+                sync.arrive_and_wait();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (std::ptrdiff_t t = 1; t < crew; ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker(); // the calling thread works too
+        for (auto& t : pool)
+        {
+            t.join();
+        }
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+        if (cancelled)
+        {
+            throw SimulationCancelled();
+        }
+    }
+
+    void writeBlock(ResultWriter& writer, std::uint64_t b, Scratch& scratch) const
+    {
+        const std::uint64_t n = blockPaths(b);
+        std::vector<char>& record = scratch.record;
+        record.resize(2 * sizeof(std::uint64_t) + n * sizeof(double));
+        std::memcpy(record.data(), &b, sizeof b);
+        std::memcpy(record.data() + sizeof b, &n, sizeof n);
+        std::memcpy(record.data() + 2 * sizeof b, scratch.values.data(), n * sizeof(double));
+        writer.append(record.data(), record.size());
+    }
+
+    std::uint64_t blockPaths(std::uint64_t b) const
+    {
+        return std::min<std::uint64_t>(BlockSize, paths - b * BlockSize);
+    }
+
+    // `count` normals of block b from counters {i, b, stream}: the first words of each counter give
+    // out[0, pairs), the last words out[pairs, 2 pairs). out must hold 2 * pairs values.
+    void blockNormals(std::uint64_t b, std::uint32_t stream, double* out, std::size_t count) const
+    {
+        const std::size_t pairs = (count + 1) / 2;
+        philox::fillUniforms(philox::keyFromSeed(seed), {0, static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(b >> 32), stream},
+                             out, out + pairs, pairs);
+        normal::inverseCdf(out, out, count);
+    }
+
+    // Fills values with terminal spots for block b, then prices them in one batch call.
+    // With antithetic variates the second half of the block mirrors the first: path h+i uses -Z_i.
+    BlockStats simulateBlock(std::uint64_t b, Scratch& scratch) const
+    {
+        const std::size_t n = blockPaths(b);
+        const bool antithetic = mode == VarianceReduction::Antithetic;
+        const std::size_t normals = antithetic ? n / 2 : n;
+        simulateSpots(b, scratch);
+        std::span<double> values(scratch.values.data(), n);
+        std::span<double> control(scratch.control.data(), n);
+        if (mode == VarianceReduction::ControlVariate)
+        {
+            PayoffCall(controlStrike).evaluate(values, control); // before values are overwritten
+        }
+        payoff.evaluate(values, values); // one virtual call per block, in place
+
+        BlockStats s;
+        s.value = Welford::of(values);
+        if (antithetic)
+        {
+            for (std::size_t i = 0; i < normals; ++i)
+            {
+                control[i] = 0.5 * (values[i] + values[normals + i]); // the control buffer is unused in this mode
+            }
+            s.pair = Welford::of(control.first(normals));
+        }
+        if (mode == VarianceReduction::ControlVariate)
+        {
+            s.control = WelfordCovariance::of(values, control);
+        }
+        return s;
+    }
+
+    // Terminal spots of block b into scratch.values.
+    void simulateSpots(std::uint64_t b, Scratch& scratch) const
+    {
+        const std::size_t n = blockPaths(b);
+        const bool antithetic = mode == VarianceReduction::Antithetic;
+        const std::size_t normals = antithetic ? n / 2 : n;
+        const double drift = (market.Rate - 0.5 * market.Vol * market.Vol) * market.Expiry;
+        const double diffusion = market.Vol * std::sqrt(market.Expiry);
+        std::vector<double>& spots = scratch.values;
+        blockNormals(b, 0, spots.data(), normals);
+        for (std::size_t i = 0; i < normals; ++i)
+        {
+            const double z = spots[i];
+            spots[i] = market.Spot * std::exp(drift + diffusion * z);
+            if (antithetic)
+            {
+                spots[normals + i] = market.Spot * std::exp(drift - diffusion * z);
+            }
+        }
+    }
+
+    // The spots of block b swept across the whole chain; sums are shifted by `shift`, see OptionChain.
+    std::vector<Welford> simulateChainBlock(std::uint64_t b, Scratch& scratch, const OptionChain& chain,
+                                            std::span<const double> shift) const
+    {
+        const std::size_t n = blockPaths(b);
+        simulateSpots(b, scratch);
+        std::vector<double> sum(chain.size(), 0.0), sumSq(chain.size(), 0.0);
+        chain.accumulate(std::span<const double>(scratch.values.data(), n), shift, sum, sumSq);
+        std::vector<Welford> stats(chain.size());
+        for (std::size_t j = 0; j < chain.size(); ++j)
+        {
+            const double m = static_cast<double>(n);
+            stats[j] = {n, shift[j] + sum[j] / m, std::max(0.0, sumSq[j] - sum[j] * sum[j] / m)};
+        }
+        return stats;
+    }
+
+    // The inputs and the terms shared by every path (drift, diffusion, discount) are recorded on a
+    // tape local to this call, so the block's sums do not depend on which thread runs it. The path
+    // itself, V = discount * payoff(S_T) with S_T = spot * exp(drift + diffusion * z), is too short
+    // to be worth a tape: its adjoint is written out by hand, so that each path costs about what
+    // it costs to price it, and the per-path adjoints of the shared terms are summed over the
+    // block. One sweep then pushes those sums down to the four inputs.
+    GreekSums simulateGreeksBlock(std::uint64_t b, Scratch& scratch) const
+    {
+        aad::Tape tape;
+        aad::ActiveTape guard(tape);
+        const aad::Number spot = aad::Number::input(market.Spot);
+        const aad::Number vol = aad::Number::input(market.Vol);
+        const aad::Number rate = aad::Number::input(market.Rate);
+        const aad::Number expiry = aad::Number::input(market.Expiry);
+        const aad::Number drift = (rate - 0.5 * vol * vol) * expiry;
+        const aad::Number diffusion = vol * sqrt(expiry);
+        const aad::Number discount = exp(-rate * expiry);
+
+        const std::size_t n = blockPaths(b);
+        double* z = scratch.values.data();
+        double* terminal = scratch.control.data();
+        blockNormals(b, 0, z, n); // the same paths as simulateBlock
+        const double s0 = spot.getValue(), mu = drift.getValue(), sigma = diffusion.getValue();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            terminal[i] = s0 * std::exp(mu + sigma * z[i]);
+        }
+        // dV/dS_T = discount * payoff'(S_T), and dS_T/d(drift) = S_T, dS_T/d(diffusion) = S_T z.
+        double sumDS = 0.0, sumDSZ = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const double ds = payoff.get().derivative(terminal[i]) * terminal[i];
+            sumDS += ds;
+            sumDSZ += ds * z[i];
+        }
+        std::span<double> values(scratch.values.data(), n); // z is no longer needed
+        payoff.evaluate(std::span<const double>(terminal, n), values);
+        double sumPayoff = 0.0;
+        const double d = discount.getValue();
+        for (double& v : values)
+        {
+            sumPayoff += v;
+            v *= d;
+        }
+        tape.adjoint(spot.getIndex()) += d * sumDS / s0;
+        tape.adjoint(drift.getIndex()) += d * sumDS;
+        tape.adjoint(diffusion.getIndex()) += d * sumDSZ;
+        tape.adjoint(discount.getIndex()) += sumPayoff;
+        tape.sweep(tape.mark(), 0);
+
+        GreekSums s;
+        s.value = Welford::of(std::span<const double>(values));
+        s.dSpot = spot.adjoint();
+        s.dVol = vol.adjoint();
+        s.dRate = rate.adjoint();
+        s.dExpiry = expiry.adjoint();
+        return s;
+    }
+
+    // One block of path simulation. Block b belongs to replication b % replications; with Sobol it
+    // takes the points of its replication's stream starting at (b / replications) * BlockSize + 1
+    // (point 0 is skipped), so each block knows its points without depending on other blocks.
+    Welford simulatePathBlock(std::uint64_t b, Scratch& scratch, const PathPayoff& pathPayoff, const BrownianBridge& bridge,
+                                const std::vector<double>& times, const sobol::Directions* directions,
+                                std::uint64_t replications) const
+    {
+        const std::size_t n = blockPaths(b);
+        const std::size_t steps = times.size();
+        scratch.normals.assign((steps + 1) * PathChunk, 0.0); // the extra row takes the unused half of an odd pair
+        scratch.path.assign(steps * PathChunk, 0.0);
+        scratch.point.resize(steps);
+        std::optional<sobol::Sequence> sequence;
+        if (directions)
+        {
+            sequence.emplace(*directions, seed * replications + b % replications + 1);
+            sequence->skipTo((b / replications) * BlockSize + 1);
+        }
+        const philox::Key key = philox::keyFromSeed(seed);
+        const std::uint32_t blockLo = static_cast<std::uint32_t>(b), blockHi = static_cast<std::uint32_t>(b >> 32);
+        std::vector<double> logDrift(steps);
+        for (std::size_t k = 0; k < steps; ++k)
+        {
+            logDrift[k] = std::log(market.Spot) + (market.Rate - 0.5 * market.Vol * market.Vol) * times[k];
+        }
+
+        Welford s;
+        std::span<double> out(scratch.values.data(), PathChunk);
+        for (std::size_t c = 0; c < n; c += PathChunk)
+        {
+            const std::size_t m = std::min(PathChunk, n - c);
+            // Uniforms first, row by row, then one batch pass through the inverse CDF per row.
+            double* z = scratch.normals.data();
+            if (sequence)
+            {
+                for (std::size_t j = 0; j < m; ++j)
+                {
+                    sequence->next(scratch.point);
+                    for (std::size_t d = 0; d < steps; ++d)
+                    {
+                        z[d * PathChunk + j] = scratch.point[d];
+                    }
+                }
+            }
+            else
+            {
+                // stream word 1 + d/2 keeps these normals apart from the terminal-spot ones (stream 0)
+                for (std::size_t d = 0; d < steps; d += 2)
+                {
+                    philox::fillUniforms(key, {static_cast<std::uint32_t>(c), blockLo, blockHi, static_cast<std::uint32_t>(1 + d / 2)},
+                                         z + d * PathChunk, z + (d + 1) * PathChunk, m);
+                }
+            }
+            for (std::size_t d = 0; d < steps; ++d)
+            {
+                normal::inverseCdf(z + d * PathChunk, z + d * PathChunk, m);
+            }
+            double* w = scratch.path.data();
+            bridge.buildPaths(z, w, PathChunk);
+            for (std::size_t k = 0; k < steps; ++k)
+            {
+                double* row = w + k * PathChunk;
+                for (std::size_t j = 0; j < PathChunk; ++j)
+                {
+                    row[j] = std::exp(logDrift[k] + market.Vol * row[j]);
+                }
+            }
+            pathPayoff.evaluate(w, steps, PathChunk, out.first(m));
+            s.merge(Welford::of(out.first(m)));
+        }
+        return s;
+    }
+
+    // Prices from the statistics of the blocks simulated so far (all of them, unless a run stopped early).
+    MCResult summarize(const BlockStats& total) const
+    {
+        const std::uint64_t used = total.value.count;
+        const double n = static_cast<double>(used);
+        const double discount = std::exp(-market.Rate * market.Expiry);
+        const double plainVariance = total.value.variance();
+
+        if (mode == VarianceReduction::Antithetic)
+        {
+            // n/2 independent pair means, each costing two payoff evaluations.
+            const double pairs = static_cast<double>(total.pair.count);
+            const double pairVariance = total.pair.variance();
+            const double factor = pairVariance > 0.0 ? plainVariance / (2.0 * pairVariance) : 1.0;
+            return {discount * total.pair.mean, discount * std::sqrt(pairVariance / pairs), used, factor};
+        }
+        if (mode == VarianceReduction::ControlVariate)
+        {
+            // f - beta (x - E[x]), with beta = Cov(f,x)/Var(x) estimated from the same paths.
+            const double controlVariance = total.control.y.variance();
+            const double covariance = total.control.covariance();
+            const double beta = controlVariance > 0.0 ? covariance / controlVariance : 0.0;
+            const double expectedControl = blackscholes::callPrice(market.Spot, controlStrike, market.Rate, market.Vol,
+                                                                   market.Expiry) / discount;
+            const double adjustedVariance = std::max(0.0, plainVariance - beta * covariance);
+            const double factor = adjustedVariance > 0.0 ? plainVariance / adjustedVariance : 1.0;
+            return {discount * (total.value.mean - beta * (total.control.y.mean - expectedControl)),
+                    discount * std::sqrt(adjustedVariance / n), used, factor};
+        }
+        return {discount * total.value.mean, discount * std::sqrt(plainVariance / n), used, 1.0};
+    }
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include "../item_07/payoffholder.h"
+
+// Payoff of a whole path, for MCEngine::runPathSimulation. Like Payoff it is a polymorphic base
+// with clone() and a virtual destructor (Item 7), and it works on whole batches: spots is a
+// step-major matrix (row k holds the spot at observation k of every path, rows are `stride` apart)
+// and out receives one value per path.
+class PathPayoff
+{
+public:
+    PathPayoff() = default;
+    virtual void evaluate(const double* spots, std::size_t steps, std::size_t stride, std::span<double> out) const = 0;
+    virtual PathPayoff* clone() const = 0;
+    virtual ~PathPayoff() = default;
+};
+
+// Arithmetic average of the observed spots, fed to any item_07 Payoff:
+// AsianPayoff(PayoffCall(100)) pays max(mean(S) - 100, 0).
+class AsianPayoff : public PathPayoff
+{
+public:
+    explicit AsianPayoff(const Payoff& inner_) : inner{PayoffHolder::fromClone(inner_)} {}
+
+    void evaluate(const double* spots, std::size_t steps, std::size_t stride, std::span<double> out) const override
+    {
+        const std::size_t paths = out.size();
+        for (std::size_t j = 0; j < paths; ++j)
+        {
+            out[j] = 0.0;
+        }
+        for (std::size_t k = 0; k < steps; ++k) // row by row, so every inner loop is contiguous
+        {
+            const double* row = spots + k * stride;
+            for (std::size_t j = 0; j < paths; ++j)
+            {
+                out[j] += row[j];
+            }
+        }
+        const double scale = 1.0 / static_cast<double>(steps);
+        for (std::size_t j = 0; j < paths; ++j)
+        {
+            out[j] *= scale;
+        }
+        inner.evaluate(out, out);
+    }
+
+    PathPayoff* clone() const override { return new AsianPayoff(*this); }
+
+private:
+    PayoffHolder inner;
+};
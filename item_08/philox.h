@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <experimental/simd>
+#include <numbers>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// A counter-based generator is a pure function (counter, key) -> 128 random bits: there is no
+// state to carry from one draw to the next, so any thread can produce the numbers of any path
+// directly, and the numbers of path p do not depend on which thread simulates it.
+
+namespace philox
+{
+
+using Counter = std::array<std::uint32_t, 4>;
+using Key = std::array<std::uint32_t, 2>;
+
+inline Counter philox4x32(Counter c, Key k)
+{
+    constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    for (int round = 0; round < 10; ++round)
+    {
+        const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c[0];
+        const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c[2];
+        c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<std::uint32_t>(p0)};
+        k[0] += W0;
+        k[1] += W1;
+    }
+    return c;
+}
+
+inline Key keyFromSeed(std::uint64_t seed)
+{
+    return {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+}
+
+// 53 random bits mapped to the open interval (0,1), so log(u) is always finite.
+inline double toUniform(std::uint32_t hi, std::uint32_t lo)
+{
+    const std::uint64_t bits = (static_cast<std::uint64_t>(hi) << 21) ^ (lo >> 11);
+    return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+}
+
+// Two independent standard normals (Box-Muller) from one Philox block.
+inline std::array<double, 2> normalPair(const Counter& c, const Key& k)
+{
+    const Counter r = philox4x32(c, k);
+    const double u1 = toUniform(r[0], r[1]);
+    const double u2 = toUniform(r[2], r[3]);
+    const double radius = std::sqrt(-2.0 * std::log(u1));
+    const double angle = 2.0 * std::numbers::pi * u2;
+    return {radius * std::cos(angle), radius * std::sin(angle)};
+}
+
+// Batch form of toUniform(philox4x32(...)): counter start + {i, 0, 0, 0} gives first[i] from its
+// first two words and second[i] from the last two, i < n (second may be null). Four SIMD vectors of
+// counters go through the rounds together, each word in its own 64-bit lane so the 32x32->64 products are
+// plain lane multiplies; the output is bitwise identical to the scalar functions.
+inline void fillUniforms(const Key& k, const Counter& start, double* first, double* second, std::size_t n)
+{
+    namespace stdx = std::experimental;
+    constexpr std::size_t Width = 4 * stdx::native_simd<double>::size(); // independent chains hide the multiply latency
+    using Vec = stdx::fixed_size_simd<double, Width>;
+    using Lanes = stdx::fixed_size_simd<std::uint64_t, Width>;
+    using Signed = stdx::fixed_size_simd<std::int64_t, Width>;
+    constexpr std::uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    constexpr std::uint64_t Low = 0xFFFFFFFF;
+    const Lanes lane([](auto i) { return static_cast<std::uint64_t>(i); });
+    const auto toVec = [](const Lanes& hi, const Lanes& lo)
+    {
+        const Lanes bits = (hi << 21) ^ (lo >> 11);
+        return (stdx::static_simd_cast<Vec>(stdx::static_simd_cast<Signed>(bits)) + 0.5) * 0x1.0p-53;
+    };
+    const std::size_t simdEnd = n - n % Width;
+    for (std::size_t i = 0; i < simdEnd; i += Width)
+    {
+        Lanes c0 = (Lanes(start[0] + i) + lane) & Low, c1(start[1]), c2(start[2]), c3(start[3]);
+        std::uint32_t k0 = k[0], k1 = k[1];
+        for (int round = 0; round < 10; ++round)
+        {
+            const Lanes p0 = c0 * M0;
+            const Lanes p1 = c2 * M1;
+            c0 = (p1 >> 32) ^ c1 ^ Lanes(k0);
+            c1 = p1 & Low;
+            c2 = (p0 >> 32) ^ c3 ^ Lanes(k1);
+            c3 = p0 & Low;
+            k0 += W0;
+            k1 += W1;
+        }
+        toVec(c0, c1).copy_to(first + i, stdx::element_aligned);
+        if (second)
+        {
+            toVec(c2, c3).copy_to(second + i, stdx::element_aligned);
+        }
+    }
+    for (std::size_t i = simdEnd; i < n; ++i)
+    {
+        const Counter r = philox4x32({static_cast<std::uint32_t>(start[0] + i), start[1], start[2], start[3]}, k);
+        first[i] = toUniform(r[0], r[1]);
+        if (second)
+        {
+            second[i] = toUniform(r[2], r[3]);
+        }
+    }
+}
+
+} // namespace philox
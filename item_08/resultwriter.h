@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Outcome of a ResultWriter, checked explicitly by the client before shutdown.
+struct WriteStatus
+{
+    bool ok = true;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t droppedRecords = 0; // ResultWriter::Overflow::Drop only
+    std::uint64_t droppedBytes = 0;
+    std::size_t buffers = 0; // most buffers in use at once
+    std::string message; // first error, empty when ok
+};
+
+// Buffered binary writer. Producers append into the front buffer; when it is full it is queued
+// and a fresh one taken from a small ring, while a background thread streams the queued buffers
+// to the file and returns them to the ring. A producer never waits for the disk: if the writer
+// falls so far behind that the whole ring is queued, the Overflow policy decides between adding a
+// buffer and dropping the record.
+//
+// Write errors never throw on the producer side: the first one is recorded, later appends are
+// dropped, and close() reports it. As with DBConn in main2.cpp, the destructor closes for clients
+// that forgot to, but it swallows the status; call close() to see it.
+class ResultWriter
+{
+public:
+    // What append() does when every buffer is full because the disk is slower than the producers.
+    // Either way the producer is not held up.
+    enum class Overflow
+    {
+        Grow, // add a buffer: nothing is lost, and memory grows until the disk catches up
+        Drop  // drop the record and count it in WriteStatus: memory stays at ringBuffers buffers
+    };
+
+    explicit ResultWriter(const std::string& path, std::size_t bufferBytes = 1 << 20, std::size_t ringBuffers_ = 4,
+                          Overflow policy_ = Overflow::Grow)
+        : capacity{bufferBytes}, ringBuffers{std::max<std::size_t>(2, ringBuffers_)}, policy{policy_}
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            // Failing to open is reported up front, at construction, not later from a destructor.
+            throw std::runtime_error("ResultWriter: cannot open " + path + ": " + std::strerror(errno));
+        }
+        front.reserve(capacity);
+        for (std::size_t i = 1; i < ringBuffers; ++i)
+        {
+            spare.emplace_back().reserve(capacity);
+        }
+        allocated = ringBuffers;
+        current.buffers = 1;
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    ~ResultWriter()
+    {
+        close(); // status is lost here, clients should call close() themselves
+    }
+
+    // Thread safe. Each call is written contiguously, calls from different threads are not interleaved.
+    void append(const void* data, std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (failed || closing)
+        {
+            return;
+        }
+        if (front.size() + n > capacity && !front.empty() && !rotate())
+        {
+            ++current.droppedRecords;
+            current.droppedBytes += n;
+            return;
+        }
+        const auto* p = static_cast<const char*>(data);
+        front.insert(front.end(), p, p + n);
+    }
+
+    template <typename T>
+    void append(std::span<const T> values)
+    {
+        append(values.data(), values.size_bytes());
+    }
+
+    // Non-blocking view of the current status.
+    WriteStatus status() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return current;
+    }
+
+    // Flushes what is left, stops the writer thread and returns the final status. Later calls, and
+    // calls racing with the first, return the same status.
+    WriteStatus close()
+    {
+        std::lock_guard<std::mutex> closeLock(closeMutex);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (closed)
+            {
+                return current;
+            }
+            if (!front.empty())
+            {
+                queued.push_back(std::move(front));
+            }
+            closing = true;
+        }
+        cv.notify_all();
+        writer.join();
+        if (::fsync(fd) != 0 && current.ok)
+        {
+            fail(std::string("fsync failed: ") + std::strerror(errno));
+        }
+        if (::close(fd) != 0 && current.ok)
+        {
+            fail(std::string("close failed: ") + std::strerror(errno));
+        }
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        return current;
+    }
+
+private:
+    std::size_t capacity;
+    std::size_t ringBuffers;
+    Overflow policy;
+    int fd = -1;
+    std::vector<char> front;                // being filled by producers
+    std::deque<std::vector<char>> queued;   // full, waiting for the writer thread
+    std::vector<std::vector<char>> spare;   // empty, ready to become the front buffer
+    std::size_t allocated = 0;              // buffers in all three places and in the writer's hands
+    bool closing = false;
+    bool closed = false;
+    bool failed = false;
+    WriteStatus current;
+
+    std::mutex closeMutex; // serializes close()
+    mutable std::mutex m;
+    std::condition_variable cv;
+    std::thread writer;
+
+    // Called with the lock held. Queues the front buffer and takes a spare one; when there is no
+    // spare, grows the ring or, under Overflow::Drop, returns false and queues nothing.
+    bool rotate()
+    {
+        if (spare.empty())
+        {
+            if (policy == Overflow::Drop)
+            {
+                return false;
+            }
+            spare.emplace_back().reserve(capacity);
+            ++allocated;
+        }
+        queued.push_back(std::move(front));
+        front = std::move(spare.back());
+        spare.pop_back();
+        current.buffers = std::max(current.buffers, allocated - spare.size());
+        cv.notify_all();
+        return true;
+    }
+
+    void fail(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        failed = true;
+        current.ok = false;
+        current.message = message;
+    }
+
+    void writeLoop()
+    {
+        for (;;)
+        {
+            std::vector<char> buffer;
+            bool ok;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] { return !queued.empty() || closing; });
+                if (queued.empty())
+                {
+                    return; // closing and everything has been written
+                }
+                buffer = std::move(queued.front());
+                queued.pop_front();
+                ok = !failed;
+            }
+            // buffer belongs to this thread until it goes back to the spares, so no lock during I/O.
+            std::size_t done = 0;
+            while (ok && done < buffer.size())
+            {
+                ssize_t w = ::write(fd, buffer.data() + done, buffer.size() - done);
+                if (w < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (w <= 0)
+                {
+                    fail(std::string("write failed: ") + std::strerror(errno));
+                    ok = false;
+                    break;
+                }
+                done += static_cast<std::size_t>(w);
+            }
+            buffer.clear();
+            std::lock_guard<std::mutex> lock(m);
+            current.bytesWritten += done;
+            spare.push_back(std::move(buffer));
+        }
+    }
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "joekuo.h"
+
+// Sobol low-discrepancy sequence, 32-bit, generated in Gray code order (Antonov-Saleev).
+//
+// Dimension 1 is the van der Corput sequence. Dimension d > 1 uses the (d-1)-th primitive polynomial
+// over GF(2), enumerated by degree and then by coefficients, which is the ordering of the Joe-Kuo
+// tables, and takes its initial direction numbers from Joe and Kuo's new-joe-kuo-6.21201 file
+// (joekuo.h), whose choice optimizes the two-dimensional projections. The table shipped covers
+// joekuo::MaxDimensions = 4096 dimensions, which is also the most a Directions can have.
+//
+// Scrambling is a random digital shift: every coordinate is XORed with a per-dimension random word.
+// The shifted points keep their net structure, are uniform on (0,1) on average, and independent
+// shifts give independent replications from which a standard error can be estimated.
+
+namespace sobol
+{
+
+constexpr unsigned Bits = 32;
+
+// Multiplication of polynomials over GF(2) modulo p (degree deg), all bit-encoded.
+inline std::uint64_t mulMod(std::uint64_t a, std::uint64_t b, std::uint64_t p, unsigned deg)
+{
+    std::uint64_t r = 0;
+    while (b)
+    {
+        if (b & 1)
+        {
+            r ^= a;
+        }
+        b >>= 1;
+        a <<= 1;
+        if (a >> deg & 1)
+        {
+            a ^= p;
+        }
+    }
+    return r;
+}
+
+inline std::uint64_t powMod(std::uint64_t e, std::uint64_t p, unsigned deg)
+{
+    std::uint64_t result = 1, base = 2; // the polynomial x
+    while (e)
+    {
+        if (e & 1)
+        {
+            result = mulMod(result, base, p, deg);
+        }
+        base = mulMod(base, base, p, deg);
+        e >>= 1;
+    }
+    return result;
+}
+
+// p (with p(0) = 1) is primitive iff x has multiplicative order exactly 2^deg - 1 modulo p.
+inline bool isPrimitive(std::uint64_t p, unsigned deg)
+{
+    const std::uint64_t order = (std::uint64_t{1} << deg) - 1;
+    if (powMod(order, p, deg) != 1)
+    {
+        return false;
+    }
+    std::uint64_t rest = order;
+    for (std::uint64_t q = 2; q * q <= rest; ++q)
+    {
+        if (rest % q == 0)
+        {
+            if (powMod(order / q, p, deg) == 1)
+            {
+                return false;
+            }
+            while (rest % q == 0)
+            {
+                rest /= q;
+            }
+        }
+    }
+    return rest == 1 || powMod(order / rest, p, deg) != 1;
+}
+
+// Direction numbers for `dims` dimensions, shared (read-only) by every generator of a run.
+class Directions
+{
+public:
+    explicit Directions(unsigned dims_) : dims{dims_}, v(static_cast<std::size_t>(dims_) * Bits)
+    {
+        if (dims == 0 || dims > joekuo::MaxDimensions)
+        {
+            throw std::invalid_argument("sobol::Directions: between 1 and " + std::to_string(joekuo::MaxDimensions)
+                                        + " dimensions");
+        }
+        for (unsigned k = 0; k < Bits; ++k)
+        {
+            v[k] = std::uint32_t{1} << (Bits - 1 - k); // dimension 1: m_k = 1
+        }
+        const std::uint32_t* initial = joekuo::m; // the row of dimension d
+        unsigned d = 1;
+        for (unsigned deg = 1; d < dims; ++deg)
+        {
+            for (std::uint64_t a = 0; a < (std::uint64_t{1} << (deg - 1)) && d < dims; ++a)
+            {
+                const std::uint64_t poly = (std::uint64_t{1} << deg) | (a << 1) | 1;
+                if (isPrimitive(poly, deg))
+                {
+                    initDimension(d++, deg, a, initial);
+                    initial += deg;
+                }
+            }
+        }
+    }
+
+    unsigned size() const { return dims; }
+    std::uint32_t operator()(unsigned dim, unsigned bit) const { return v[static_cast<std::size_t>(dim) * Bits + bit]; }
+
+private:
+    unsigned dims;
+    std::vector<std::uint32_t> v; // v[dim*Bits + k] = m_{k+1} << (31 - k)
+
+    // initial: m_1 .. m_s from the Joe-Kuo table; the rest follow from the recurrence of the
+    // polynomial of degree s with middle coefficients a.
+    void initDimension(unsigned d, unsigned s, std::uint64_t a, const std::uint32_t* initial)
+    {
+        std::uint32_t m[Bits + 1];
+        for (unsigned k = 1; k <= s; ++k)
+        {
+            m[k] = initial[k - 1];
+        }
+        for (unsigned k = s + 1; k <= Bits; ++k)
+        {
+            m[k] = m[k - s] ^ (m[k - s] << s);
+            for (unsigned j = 1; j < s; ++j)
+            {
+                if (a >> (s - 1 - j) & 1)
+                {
+                    m[k] ^= m[k - j] << j;
+                }
+            }
+        }
+        for (unsigned k = 1; k <= Bits; ++k)
+        {
+            v[static_cast<std::size_t>(d) * Bits + k - 1] = m[k] << (Bits - k);
+        }
+    }
+};
+
+// One stream of points. Cheap to create: a generator per thread or per block is the intended use.
+class Sequence
+{
+public:
+    Sequence(const Directions& directions_, std::uint64_t scrambleSeed = 0)
+        : directions{&directions_}, x(directions_.size(), 0), shift(directions_.size(), 0)
+    {
+        if (scrambleSeed != 0)
+        {
+            std::uint64_t z = scrambleSeed;
+            for (auto& s : shift)
+            {
+                z += 0x9e3779b97f4a7c15ull; // splitmix64
+                std::uint64_t t = z;
+                t = (t ^ (t >> 30)) * 0xbf58476d1ce4e5b9ull;
+                t = (t ^ (t >> 27)) * 0x94d049bb133111ebull;
+                s = static_cast<std::uint32_t>((t ^ (t >> 31)) >> 32);
+            }
+        }
+    }
+
+    // Positions the sequence so that the next point is point `i` (in Gray code order),
+    // letting every block of a parallel run start at its own offset.
+    void skipTo(std::uint64_t i)
+    {
+        const std::uint64_t gray = i ^ (i >> 1);
+        for (unsigned d = 0; d < x.size(); ++d)
+        {
+            std::uint32_t value = 0;
+            for (unsigned k = 0; k < Bits; ++k)
+            {
+                if (gray >> k & 1)
+                {
+                    value ^= (*directions)(d, k);
+                }
+            }
+            x[d] = value;
+        }
+        index = i;
+    }
+
+    // Writes the next point as uniforms in the open interval (0,1).
+    void next(std::span<double> point)
+    {
+        for (unsigned d = 0; d < x.size(); ++d)
+        {
+            point[d] = (static_cast<double>(x[d] ^ shift[d]) + 0.5) * 0x1.0p-32;
+        }
+        const unsigned c = static_cast<unsigned>(std::countr_one(index)); // bit that changes in Gray code
+        if (c >= Bits)
+        {
+            throw std::out_of_range("sobol::Sequence: more than 2^32 points");
+        }
+        for (unsigned d = 0; d < x.size(); ++d)
+        {
+            x[d] ^= (*directions)(d, c);
+        }
+        ++index;
+    }
+
+    unsigned dimensions() const { return static_cast<unsigned>(x.size()); }
+
+private:
+    const Directions* directions;
+    std::vector<std::uint32_t> x;
+    std::vector<std::uint32_t> shift;
+    std::uint64_t index = 0;
+};
+
+} // namespace sobol
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <experimental/simd>
+#include <span>
+
+// Mean and sum of squared deviations of a sample (Welford), and the same for two variables together
+// with their co-moment. Unlike running sums of x and x^2 they do not lose the variance to
+// cancellation when the mean is large compared with the spread.
+//
+// merge() combines the statistics of two disjoint samples exactly as if one accumulator had seen
+// both (Chan, Golub and LeVeque). Floating-point merging is not associative, so the result depends
+// on the order of the merges, and only on that: folding per-block accumulators in block order gives
+// bitwise the same statistics however the blocks were spread over threads.
+
+struct Welford
+{
+    std::uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0; // sum of (x - mean)^2
+
+    void add(double x)
+    {
+        ++count;
+        const double delta = x - mean;
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (x - mean);
+    }
+
+    // Two passes over a batch already in memory: the same statistics without a division per value.
+    // Both sums run in SIMD lanes, which breaks the dependency chain of a scalar reduction.
+    static Welford of(std::span<const double> xs)
+    {
+        Welford w;
+        if (xs.empty())
+        {
+            return w;
+        }
+        w.count = xs.size();
+        w.mean = sum(xs, [](Vec x) { return x; }, [](double x) { return x; }) / static_cast<double>(w.count);
+        const double mean = w.mean;
+        w.m2 = sum(xs, [mean](Vec x) { return (x - mean) * (x - mean); }, [mean](double x) { return (x - mean) * (x - mean); });
+        return w;
+    }
+
+    void merge(const Welford& o)
+    {
+        if (o.count == 0)
+        {
+            return;
+        }
+        if (count == 0)
+        {
+            *this = o;
+            return;
+        }
+        const double n = static_cast<double>(count + o.count);
+        const double delta = o.mean - mean;
+        const double share = static_cast<double>(o.count) / n;
+        mean += delta * share;
+        m2 += o.m2 + delta * delta * static_cast<double>(count) * share;
+        count += o.count;
+    }
+
+    double variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+
+private:
+    using Vec = std::experimental::native_simd<double>;
+
+    template <typename F, typename G>
+    static double sum(std::span<const double> xs, F vectorTerm, G scalarTerm)
+    {
+        const std::size_t simdEnd = xs.size() - xs.size() % Vec::size();
+        Vec lanes(0.0);
+        for (std::size_t i = 0; i < simdEnd; i += Vec::size())
+        {
+            lanes += vectorTerm(Vec(xs.data() + i, std::experimental::element_aligned));
+        }
+        double total = std::experimental::reduce(lanes);
+        for (std::size_t i = simdEnd; i < xs.size(); ++i)
+        {
+            total += scalarTerm(xs[i]);
+        }
+        return total;
+    }
+};
+
+// Two variables observed together: both marginals and the co-moment sum (x - mean x)(y - mean y).
+struct WelfordCovariance
+{
+    Welford x;
+    Welford y;
+    double cxy = 0.0;
+
+    static WelfordCovariance of(std::span<const double> xs, std::span<const double> ys)
+    {
+        WelfordCovariance w{Welford::of(xs), Welford::of(ys)};
+        for (std::size_t i = 0; i < xs.size(); ++i)
+        {
+            w.cxy += (xs[i] - w.x.mean) * (ys[i] - w.y.mean);
+        }
+        return w;
+    }
+
+    void merge(const WelfordCovariance& o)
+    {
+        if (o.x.count != 0 && x.count != 0)
+        {
+            const double n = static_cast<double>(x.count + o.x.count);
+            cxy += o.cxy + (o.x.mean - x.mean) * (o.y.mean - y.mean) * static_cast<double>(x.count)
+                                                * static_cast<double>(o.x.count) / n;
+        }
+        else if (x.count == 0)
+        {
+            cxy = o.cxy;
+        }
+        x.merge(o.x);
+        y.merge(o.y);
+    }
+
+    double covariance() const { return x.count > 1 ? cxy / static_cast<double>(x.count - 1) : 0.0; }
+};
@@ -0,0 +1,270 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mcengine.h"
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own work at the
+// back (most recent first, good for locality), and when its deque is empty it steals the oldest
+// task from the front of another worker's deque. Tasks submitted from inside a worker go to that
+// worker's deque, so nested work stays local until somebody is idle.
+//
+// A task must not let an exception escape; if one does anyway it is stored (see takeErrors())
+// instead of reaching std::thread and calling std::terminate.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threads_ = std::thread::hardware_concurrency())
+    {
+        const unsigned n = std::max(1u, threads_);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 0; i < n; ++i)
+        {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers)
+        {
+            w.join();
+        }
+    }
+
+    void submit(std::function<void()> task)
+    {
+        const std::size_t q = (self.pool == this) ? self.index : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->m);
+            queues[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ++pending;
+            ++queued;
+        }
+        cv.notify_one();
+    }
+
+    // Blocks until every submitted task has finished. Must not be called from a task.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    std::vector<std::exception_ptr> takeErrors()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return std::exchange(errors, {});
+    }
+
+    std::size_t size() const { return workers.size(); }
+
+private:
+    struct Queue
+    {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Which pool and queue the current thread works for (pool is null for outside threads,
+    // thread_local objects are zero-initialized).
+    struct WorkerId
+    {
+        const WorkStealingPool* pool;
+        std::size_t index;
+    };
+    static inline thread_local WorkerId self;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> nextQueue{0};
+
+    std::mutex m;
+    std::condition_variable cv;   // work arrived or the pool is stopping
+    std::condition_variable idle; // pending dropped to zero
+    std::size_t pending = 0;      // submitted and not yet finished
+    std::size_t queued = 0;       // submitted and not yet started
+    bool stopping = false;
+    std::vector<std::exception_ptr> errors;
+
+    std::optional<std::function<void()>> take(std::size_t i)
+    {
+        {
+            Queue& own = *queues[i];
+            std::lock_guard<std::mutex> lock(own.m);
+            if (!own.tasks.empty())
+            {
+                auto task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k)
+        {
+            Queue& victim = *queues[(i + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (!victim.tasks.empty())
+            {
+                auto task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void workerLoop(std::size_t i)
+    {
+        self = {this, i};
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] { return stopping || queued > 0; });
+                if (queued == 0) // stopping and nothing left
+                {
+                    return;
+                }
+            }
+            auto task = take(i);
+            if (!task)
+            {
+                continue; // another worker got there first
+            }
+            {
+                std::lock_guard<std::mutex> lock(m);
+                --queued;
+            }
+            std::exception_ptr error;
+            try
+            {
+                (*task)();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(m);
+            if (error)
+            {
+                errors.push_back(error);
+            }
+            if (--pending == 0)
+            {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+// Outcome of running a batch of engines: nothing is thrown, every engine gets a status.
+struct BatchResult
+{
+    enum class Status { Succeeded, Failed, Cancelled };
+
+    struct Entry
+    {
+        Status status = Status::Cancelled;
+        std::optional<MCResult> result;
+        std::exception_ptr error; // set when status == Failed
+        std::string message;
+    };
+
+    std::vector<Entry> entries;
+
+    bool ok() const
+    {
+        return std::all_of(entries.begin(), entries.end(), [](const Entry& e) { return e.status == Status::Succeeded; });
+    }
+
+    std::size_t count(Status s) const
+    {
+        return static_cast<std::size_t>(std::count_if(entries.begin(), entries.end(), [s](const Entry& e) { return e.status == s; }));
+    }
+};
+
+enum class ErrorPolicy
+{
+    ContinueOnError, // siblings keep running, every failure is reported
+    CancelOnError    // the first failure cancels every simulation not yet finished
+};
+
+// Runs every engine as one task on the pool and waits for all of them. Engines meant for a batch
+// are best built with threads_ = 1, the pool already provides the parallelism.
+// Exceptions are caught inside the task and stored in the BatchResult, never thrown through a
+// destructor; with CancelOnError the first failure requests stop on a shared stop_source, which
+// queued tasks check before starting and running engines check between blocks.
+inline BatchResult runSimulations(WorkStealingPool& pool, const std::vector<MCEngine>& engines,
+                                  ErrorPolicy policy = ErrorPolicy::ContinueOnError)
+{
+    BatchResult batch;
+    batch.entries.resize(engines.size());
+    std::stop_source cancel;
+    std::latch finished(static_cast<std::ptrdiff_t>(engines.size()));
+    for (std::size_t i = 0; i < engines.size(); ++i)
+    {
+        pool.submit([&, i]
+        {
+            BatchResult::Entry& entry = batch.entries[i];
+            try
+            {
+                if (cancel.stop_requested())
+                {
+                    throw SimulationCancelled();
+                }
+                entry.result = engines[i].runSimulation(cancel.get_token());
+                entry.status = BatchResult::Status::Succeeded;
+            }
+            catch (const SimulationCancelled&)
+            {
+                entry.status = BatchResult::Status::Cancelled;
+            }
+            catch (const std::exception& e)
+            {
+                entry.status = BatchResult::Status::Failed;
+                entry.error = std::current_exception();
+                entry.message = e.what();
+            }
+            catch (...)
+            {
+                entry.status = BatchResult::Status::Failed;
+                entry.error = std::current_exception();
+                entry.message = "unknown exception";
+            }
+            if (entry.status == BatchResult::Status::Failed && policy == ErrorPolicy::CancelOnError)
+            {
+                cancel.request_stop();
+            }
+            finished.count_down();
+        });
+    }
+    finished.wait();
+    return batch;
+}
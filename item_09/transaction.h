@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "txlog.h"
+
+// The Transaction of main.cpp with its log made durable: the record is built before the base class
+// is constructed, by a static helper as before, and logTransaction() appends it to a TxLog and
+// waits for it to reach the disk instead of printing it. Many threads constructing transactions
+// at once share their log syncs, so this scales with the number of concurrent transactions.
+
+class Transaction
+{
+public:
+    Transaction(TxLog& log, const std::string& record)
+    {
+        init(log, record);
+    }
+
+    // The LSN of this transaction's log record.
+    std::uint64_t lsn() const { return logLsn; }
+
+private:
+    std::uint64_t logLsn = 0;
+
+    void init(TxLog& log, const std::string& record)
+    {
+        logTransaction(log, record);
+    }
+
+    void logTransaction(TxLog& log, const std::string& record)
+    {
+        logLsn = log.appendDurable(record);
+    }
+};
+
+class BuyTransaction : public Transaction
+{
+public:
+    BuyTransaction(TxLog& log, const std::string& symbol, long quantity, double price)
+        : Transaction{log, createLogString(symbol, quantity, price)}
+    {
+    }
+
+private:
+    static std::string createLogString(const std::string& symbol, long quantity, double price)
+    {
+        return "BUY " + symbol + " " + std::to_string(quantity) + " @ " + std::to_string(price);
+    }
+};
+
+class SellTransaction : public Transaction
+{
+public:
+    SellTransaction(TxLog& log, const std::string& symbol, long quantity, double price)
+        : Transaction{log, createLogString(symbol, quantity, price)}
+    {
+    }
+
+private:
+    static std::string createLogString(const std::string& symbol, long quantity, double price)
+    {
+        return "SELL " + symbol + " " + std::to_string(quantity) + " @ " + std::to_string(price);
+    }
+};
@@ -0,0 +1,595 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A durable, append-only binary transaction log.
+//
+// The log is a directory of segments, 00000000000000000000.log, 00000000000000000001.log, ...,
+// each a preallocated file of segmentBytes, filled with zeros before it is used so that writing a
+// record never extends the file: syncing it then only has data to flush, not file size or block
+// allocation metadata. The next segment is prepared in the background while the current one fills.
+//
+// Every record is length-prefixed and checksummed:
+//
+//     u32 payload length | u32 CRC-32C of (lsn, payload) | u64 lsn | payload
+//
+// LSNs (log sequence numbers) start at 1 and increase by one per record. A record never straddles
+// two segments; a zero length marks the end of the data in a segment. Reading stops at the first
+// record that is cut short, fails its checksum or breaks the LSN sequence: that is the torn tail of
+// a crash, and reopening the log continues writing from there.
+//
+// Group commit: append() only copies the record into a buffer and returns its LSN. A flusher thread
+// writes everything appended since its last sync and then syncs once for all of it (fdatasync, or
+// F_FULLFSYNC on macOS, where fdatasync does not reach the disk). A caller that needs durability
+// waits with waitDurable(lsn). With maxDelay > 0 the flusher waits up to that long after the first
+// record of a batch for more records to join (or until the batch reaches batchBytes), which bounds
+// the latency a record can be held back to group it.
+
+struct TxLogConfig
+{
+    std::size_t segmentBytes = 64 << 20;
+    std::chrono::microseconds maxDelay{0};
+    std::size_t batchBytes = 1 << 20; // flush early once this much is waiting
+};
+
+namespace txlog
+{
+
+// CRC-32C (Castagnoli), the polynomial with hardware support on x86 (SSE4.2) and ARMv8.
+inline std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t n)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#if defined(__SSE4_2__)
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc = static_cast<std::uint32_t>(__builtin_ia32_crc32di(crc, word));
+    }
+    for (; n > 0; --n, ++p)
+    {
+        crc = __builtin_ia32_crc32qi(crc, *p);
+    }
+#else
+    static const std::array<std::uint32_t, 256> table = []
+    {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    for (; n > 0; --n, ++p)
+    {
+        crc = table[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+    return ~crc;
+}
+
+struct RecordHeader
+{
+    std::uint32_t length;
+    std::uint32_t checksum;
+    std::uint64_t lsn;
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+inline std::uint32_t checksum(std::uint64_t lsn, std::string_view payload)
+{
+    return crc32c(crc32c(0, &lsn, sizeof lsn), payload.data(), payload.size());
+}
+
+inline std::string segmentName(std::uint64_t index)
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "%020llu.log", static_cast<unsigned long long>(index));
+    return name;
+}
+
+[[noreturn]] inline void fail(const std::string& what)
+{
+    throw std::runtime_error("TxLog: " + what + ": " + std::strerror(errno));
+}
+
+// Flushes the file's data to stable storage. On macOS fsync and fdatasync only hand the data to
+// the drive, which may keep it in its volatile cache; F_FULLFSYNC asks the drive to flush too.
+inline void syncData(int fd, const std::string& what)
+{
+#if defined(__APPLE__)
+    const int result = ::fcntl(fd, F_FULLFSYNC);
+#else
+    const int result = ::fdatasync(fd);
+#endif
+    if (result != 0)
+    {
+        fail("cannot sync " + what);
+    }
+}
+
+// The offset just past the last non-zero byte of the file at or after from, or from if there is none.
+inline std::size_t nonZeroEnd(const std::filesystem::path& path, std::size_t from)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        fail("cannot open " + path.string());
+    }
+    std::string chunk(1 << 20, '\0');
+    std::size_t end = from;
+    for (std::size_t at = from;;)
+    {
+        const ssize_t n = ::pread(fd, chunk.data(), chunk.size(), static_cast<off_t>(at));
+        if (n <= 0)
+        {
+            break;
+        }
+        for (ssize_t i = n; i > 0; --i)
+        {
+            if (chunk[static_cast<std::size_t>(i - 1)] != '\0')
+            {
+                end = at + static_cast<std::size_t>(i);
+                break;
+            }
+        }
+        at += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    return end;
+}
+
+// Overwrites [from, to) of the file with zeros.
+inline void zeroFill(int fd, std::size_t from, std::size_t to, const std::string& what)
+{
+    const std::string zeros(1 << 20, '\0');
+    for (std::size_t at = from; at < to; at += zeros.size())
+    {
+        const std::size_t n = std::min(zeros.size(), to - at);
+        if (::pwrite(fd, zeros.data(), n, static_cast<off_t>(at)) != static_cast<ssize_t>(n))
+        {
+            fail("cannot zero " + what);
+        }
+    }
+}
+
+// Segment indices present in directory, in order.
+inline std::vector<std::uint64_t> listSegments(const std::filesystem::path& directory)
+{
+    std::vector<std::uint64_t> indices;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.size() == 24 && name.ends_with(".log") && std::all_of(name.begin(), name.begin() + 20, ::isdigit))
+        {
+            indices.push_back(std::stoull(name.substr(0, 20)));
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+// Reads the valid records of one segment into f(lsn, payload), starting at LSN expected. Returns
+// the offset just past the last valid record, and updates expected to the LSN after it.
+template <typename F>
+std::size_t scanSegment(const std::filesystem::path& path, std::uint64_t& expected, F f)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        fail("cannot open " + path.string());
+    }
+    std::string data(std::filesystem::file_size(path), '\0');
+    std::size_t got = 0;
+    while (got < data.size())
+    {
+        const ssize_t n = ::pread(fd, data.data() + got, data.size() - got, static_cast<off_t>(got));
+        if (n <= 0)
+        {
+            break;
+        }
+        got += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    std::size_t at = 0;
+    while (at + sizeof(RecordHeader) <= got)
+    {
+        RecordHeader h;
+        std::memcpy(&h, data.data() + at, sizeof h);
+        if (h.length == 0 || h.length > got - at - sizeof h || h.lsn != expected)
+        {
+            break;
+        }
+        const std::string_view payload(data.data() + at + sizeof h, h.length);
+        if (checksum(h.lsn, payload) != h.checksum)
+        {
+            break;
+        }
+        f(h.lsn, payload);
+        ++expected;
+        at += sizeof h + h.length;
+    }
+    return at;
+}
+
+} // namespace txlog
+
+class TxLog
+{
+public:
+    explicit TxLog(const std::string& directory_, TxLogConfig config_ = {}) : directory{directory_}, config{config_}
+    {
+        if (config.segmentBytes < 4096)
+        {
+            throw std::invalid_argument("TxLog: segments must be at least 4096 bytes");
+        }
+        std::filesystem::create_directories(directory);
+        recover();
+        spare = std::async(std::launch::async, [this, index = segmentIndex + 1] { return createSegment(index); });
+        flusher = std::thread([this] { flushLoop(); });
+    }
+
+    TxLog(const TxLog&) = delete;
+    TxLog& operator=(const TxLog&) = delete;
+
+    // Makes everything appended durable, then closes. Errors are lost here: call close() to see them.
+    ~TxLog()
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    // Buffers a record and returns its LSN; it is durable once durableLsn() reaches it.
+    std::uint64_t append(std::string_view record)
+    {
+        if (record.empty() || record.size() > config.segmentBytes - sizeof(txlog::RecordHeader))
+        {
+            throw std::invalid_argument("TxLog: records must be non-empty and fit in a segment");
+        }
+        std::uint64_t lsn;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            throwIfFailed();
+            if (closing)
+            {
+                throw std::logic_error("TxLog: append after close");
+            }
+            lsn = nextLsn++;
+            const txlog::RecordHeader h{static_cast<std::uint32_t>(record.size()), txlog::checksum(lsn, record), lsn};
+            if (front.empty())
+            {
+                firstAppend = std::chrono::steady_clock::now();
+            }
+            front.append(reinterpret_cast<const char*>(&h), sizeof h);
+            front.append(record);
+        }
+        cv.notify_one();
+        return lsn;
+    }
+
+    // Blocks until the record with this LSN, and everything before it, is on disk.
+    void waitDurable(std::uint64_t lsn)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        durableCv.wait(lock, [&] { return durable >= lsn || !error.empty(); });
+        throwIfFailed();
+    }
+
+    std::uint64_t appendDurable(std::string_view record)
+    {
+        const std::uint64_t lsn = append(record);
+        waitDurable(lsn);
+        return lsn;
+    }
+
+    std::uint64_t durableLsn() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return durable;
+    }
+
+    // Number of syncs so far: appends / syncs is the average group size.
+    std::uint64_t syncs() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return syncCount;
+    }
+
+    // Flushes and syncs what is left, stops the flusher and closes the files. Throws the first I/O
+    // error the log ran into, if any.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (closed)
+            {
+                throwIfFailed();
+                return;
+            }
+            closing = true;
+        }
+        cv.notify_all();
+        flusher.join();
+        int spareFd = -1;
+        try
+        {
+            spareFd = spare.get();
+        }
+        catch (const std::exception&)
+        {
+        }
+        if (spareFd >= 0)
+        {
+            ::close(spareFd);
+        }
+        ::close(fd);
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        throwIfFailed();
+    }
+
+    // Calls f(lsn, payload) for every valid record in the log, oldest first; returns the count.
+    static std::uint64_t replay(const std::string& directory, const std::function<void(std::uint64_t, std::string_view)>& f)
+    {
+        const std::vector<std::uint64_t> indices = txlog::listSegments(directory);
+        std::uint64_t expected = 1;
+        for (std::uint64_t index : indices)
+        {
+            const std::uint64_t before = expected;
+            txlog::scanSegment(std::filesystem::path(directory) / txlog::segmentName(index), expected, f);
+            if (expected == before && index != indices.front())
+            {
+                break; // nothing valid in this segment: the log ended in the previous one
+            }
+        }
+        return expected - 1;
+    }
+
+private:
+    std::filesystem::path directory;
+    TxLogConfig config;
+
+    // Flusher thread only (and the constructor):
+    int fd = -1;
+    std::uint64_t segmentIndex = 0;
+    std::size_t offset = 0; // write position in the current segment
+    std::future<int> spare; // the next segment, being prepared
+    std::thread flusher;
+
+    mutable std::mutex m;
+    std::condition_variable cv;        // records appended, or closing
+    std::condition_variable durableCv; // durable advanced, or the log failed
+    std::string front;                 // records appended since the last swap
+    std::chrono::steady_clock::time_point firstAppend;
+    std::uint64_t nextLsn = 1;
+    std::uint64_t durable = 0;
+    std::uint64_t syncCount = 0;
+    std::string error; // the first I/O error; the log accepts nothing after it
+    bool closing = false;
+    bool closed = false;
+
+    void throwIfFailed() const
+    {
+        if (!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+    }
+
+    // Opens (creating and zero-filling if needed) the segment with this index for writing.
+    int createSegment(std::uint64_t index) const
+    {
+        const std::filesystem::path path = directory / txlog::segmentName(index);
+        const int f = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (f < 0)
+        {
+            txlog::fail("cannot open " + path.string());
+        }
+        struct stat info;
+        if (::fstat(f, &info) != 0)
+        {
+            txlog::fail("cannot stat " + path.string());
+        }
+        if (static_cast<std::size_t>(info.st_size) < config.segmentBytes)
+        {
+            txlog::zeroFill(f, static_cast<std::size_t>(info.st_size), config.segmentBytes, path.string());
+            txlog::syncData(f, path.string());
+            syncDirectory();
+        }
+        return f;
+    }
+
+    void syncDirectory() const
+    {
+        const int d = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (d >= 0)
+        {
+            ::fsync(d);
+            ::close(d);
+        }
+    }
+
+    // Finds the end of the existing log and continues from there. Whatever lies past that end, the
+    // rest of a torn segment or whole segments after it, is erased first: records written later
+    // would otherwise land in front of old records whose LSNs they happen to continue, and replay
+    // would return those as if they had been appended again.
+    void recover()
+    {
+        const std::vector<std::uint64_t> indices = txlog::listSegments(directory);
+        std::uint64_t expected = 1;
+        for (std::uint64_t index : indices)
+        {
+            const std::uint64_t before = expected;
+            const std::size_t end = txlog::scanSegment(directory / txlog::segmentName(index), expected,
+                                                       [](std::uint64_t, std::string_view) {});
+            if (expected == before && index != indices.front())
+            {
+                break; // an unused spare, or what is left past a torn tail
+            }
+            segmentIndex = index;
+            offset = end;
+        }
+        nextLsn = expected;
+        durable = expected - 1;
+        bool removed = false;
+        for (std::uint64_t index : indices)
+        {
+            if (index > segmentIndex)
+            {
+                std::filesystem::remove(directory / txlog::segmentName(index));
+                removed = true;
+            }
+        }
+        if (removed)
+        {
+            syncDirectory();
+        }
+        const std::filesystem::path path = directory / txlog::segmentName(segmentIndex);
+        const std::size_t dirty = std::filesystem::exists(path) ? txlog::nonZeroEnd(path, offset) : offset;
+        fd = createSegment(segmentIndex);
+        if (dirty > offset)
+        {
+            txlog::zeroFill(fd, offset, dirty, path.string());
+            txlog::syncData(fd, path.string());
+        }
+    }
+
+    void flushLoop()
+    {
+        std::string batch;
+        for (;;)
+        {
+            std::uint64_t last;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] { return closing || !front.empty(); });
+                if (front.empty())
+                {
+                    return; // closing and everything is durable
+                }
+                if (config.maxDelay.count() > 0)
+                {
+                    cv.wait_until(lock, firstAppend + config.maxDelay,
+                                  [this] { return closing || front.size() >= config.batchBytes; });
+                }
+                std::swap(batch, front);
+                last = nextLsn - 1;
+            }
+            // The file is written and synced without the lock: appends go on filling front.
+            std::string failure;
+            try
+            {
+                write(batch);
+            }
+            catch (const std::exception& e)
+            {
+                failure = e.what();
+            }
+            batch.clear();
+            std::lock_guard<std::mutex> lock(m);
+            if (failure.empty())
+            {
+                durable = last;
+                ++syncCount;
+            }
+            else if (error.empty())
+            {
+                error = failure;
+            }
+            durableCv.notify_all();
+            if (!error.empty())
+            {
+                front.clear();
+                return;
+            }
+        }
+    }
+
+    // Writes whole records, moving to the next segment when one does not fit, then syncs.
+    void write(const std::string& batch)
+    {
+        std::size_t at = 0;
+        while (at < batch.size())
+        {
+            // The longest run of records that fits in the rest of this segment.
+            std::size_t end = at;
+            while (end < batch.size())
+            {
+                txlog::RecordHeader h;
+                std::memcpy(&h, batch.data() + end, sizeof h);
+                const std::size_t size = sizeof h + h.length;
+                if (offset + (end - at) + size > config.segmentBytes)
+                {
+                    break;
+                }
+                end += size;
+            }
+            writeAll(batch.data() + at, end - at);
+            at = end;
+            if (at < batch.size())
+            {
+                roll();
+            }
+        }
+        txlog::syncData(fd, "segment");
+    }
+
+    void writeAll(const char* data, std::size_t n)
+    {
+        while (n > 0)
+        {
+            const ssize_t w = ::pwrite(fd, data, n, static_cast<off_t>(offset));
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                txlog::fail("write failed");
+            }
+            data += w;
+            n -= static_cast<std::size_t>(w);
+            offset += static_cast<std::size_t>(w);
+        }
+    }
+
+    // The rest of the current segment stays zero, which readers take as its end.
+    void roll()
+    {
+        txlog::syncData(fd, "segment");
+        ::close(fd);
+        fd = spare.get();
+        ++segmentIndex;
+        offset = 0;
+        spare = std::async(std::launch::async, [this, index = segmentIndex + 1] { return createSegment(index); });
+    }
+};